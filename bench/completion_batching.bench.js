@@ -0,0 +1,97 @@
+"use strict";
+
+var argv = require('minimist')(process.argv.slice(2));
+if (argv.help) {
+  console.error('Measures main thread CPU per completed request with Napi::AsyncWorker and with batched completions');
+  console.error('Example: \n\tnode bench/completion_batching.bench.js --duration 5');
+  console.error('Optional args: \n\t--duration (seconds per run, default 5)\n\t--rates (comma separated req/s, default 10000,50000,100000)\n\t--max-latency (ms, default 0)');
+  process.exit(0);
+}
+
+var child_process = require('child_process');
+var fs = require('fs');
+var performance = require('perf_hooks').performance;
+
+var duration = (argv.duration || 5) * 1000;
+var rates = String(argv.rates || '10000,50000,100000').split(',').map(Number);
+var max_latency = argv['max-latency'] || 0;
+
+// Each measurement runs in a fresh process. The child issues helloPromise()
+// calls (which do almost no work in the threadpool) at a fixed rate, so the
+// cost we see is dominated by getting completions back into Javascript.
+if (argv.child) {
+  var module = require('../lib/index.js');
+  // --max-batch-size 0 runs every request through a plain Napi::AsyncWorker
+  if (argv['max-batch-size'] === 0) {
+    module.configureBatching({ enabled: false });
+  } else {
+    module.configureBatching({ maxBatchSize: argv['max-batch-size'], maxLatency: max_latency });
+  }
+
+  var rate = argv.rate;
+  var issued = 0;
+  var completed = 0;
+  var onResult = function() { ++completed; };
+
+  // CPU time of the main thread only, in ms (Linux). process.cpuUsage()
+  // includes the threadpool, and eventLoopUtilization() measures how long the
+  // loop was busy (wall time), not how much CPU it used.
+  var mainThreadCpu = function() {
+    try {
+      return Number(fs.readFileSync('/proc/self/task/' + process.pid + '/schedstat', 'utf8').split(' ')[0]) / 1e6;
+    } catch (err) {
+      return NaN;
+    }
+  };
+
+  var start = Date.now();
+  var elu_start = performance.eventLoopUtilization();
+  var cpu_start = process.cpuUsage();
+  var main_start = mainThreadCpu();
+
+  var finish = function() {
+    if (completed < issued) return setImmediate(finish);
+    var main = mainThreadCpu() - main_start;
+    var elu = performance.eventLoopUtilization(elu_start);
+    var cpu = process.cpuUsage(cpu_start);
+    var elapsed = Date.now() - start;
+    process.stdout.write(JSON.stringify({
+      completed: completed,
+      elapsed: elapsed,
+      main_thread_cpu_ms: main,
+      loop_busy_ms: elu.active,
+      process_cpu_ms: (cpu.user + cpu.system) / 1000
+    }));
+  };
+
+  var tick = function() {
+    var elapsed = Date.now() - start;
+    if (elapsed >= duration) return finish();
+    var due = Math.floor(elapsed * rate / 1000);
+    for (; issued < due; ++issued) {
+      module.helloPromise({ phrase: 'hello', multiply: 1 }).then(onResult);
+    }
+    setTimeout(tick, 1);
+  };
+  tick();
+} else {
+  var measure = function(rate, max_batch_size) {
+    var args = [__filename, '--child', '--rate', rate, '--duration', duration / 1000, '--max-batch-size', max_batch_size, '--max-latency', max_latency];
+    var result = JSON.parse(child_process.execFileSync(process.execPath, args, { encoding: 'utf8' }));
+    var achieved = result.completed / (result.elapsed / 1000);
+    var label = max_batch_size === 0 ? 'Napi::AsyncWorker         ' : 'batched (maxBatchSize ' + max_batch_size + ')';
+    var perRequest = function(ms) { return isNaN(ms) ? 'n/a' : (ms * 1000 / result.completed).toFixed(2); };
+    console.log(rate + ' req/s ' + label + ': ' +
+      perRequest(result.main_thread_cpu_ms) + ' us main thread cpu/req, ' +
+      perRequest(result.loop_busy_ms) + ' us loop busy/req, ' +
+      perRequest(result.process_cpu_ms) + ' us process cpu/req (achieved ' + achieved.toFixed(0) + ' req/s)');
+  };
+
+  rates.forEach(function(rate) {
+    measure(rate, 0);
+    measure(rate, 1);
+    measure(rate, 256);
+  });
+
+  console.log('Benchmark duration:', duration / 1000, 's per run, maxLatency:', max_latency, 'ms');
+}
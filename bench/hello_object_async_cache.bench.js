@@ -0,0 +1,70 @@
+"use strict";
+
+var argv = require('minimist')(process.argv.slice(2));
+if (!argv.concurrency) {
+  console.error('Please provide desired concurrency');
+  console.error('Example: \n\tnode bench/hello_object_async_cache.bench.js --concurrency 10');
+  console.error('Optional args: \n\t--duration (seconds per run, default 60)\n\t--keys (distinct names, default 1000)\n\t--cache (cache file, default in os.tmpdir())');
+  process.exit(1);
+}
+
+// This env var sets the libuv threadpool size.
+// This value is locked in once a function interacts with the threadpool
+// Therefore we need to set this value either in the shell or at the very
+// top of a JS file (like we do here)
+process.env.UV_THREADPOOL_SIZE = argv.concurrency;
+
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var child_process = require('child_process');
+
+var duration = (argv.duration || 60) * 1000;
+var keys = argv.keys || 1000;
+var cache_file = argv.cache || path.join(os.tmpdir(), 'node-cpp-skel-bench.cache');
+
+// Each measurement runs in a fresh process to model a process starting up
+// after a deploy: --child runs the workload and reports how many requests
+// completed within --duration.
+if (argv.child) {
+  var module = require('../lib/index.js');
+  var objects = [];
+  for (var i = 0; i < keys; i++) {
+    var options = argv['use-cache'] ? { cache: { path: cache_file } } : undefined;
+    objects.push(new module.HelloObjectAsync('park bench ' + i, options));
+  }
+
+  var runs = 0;
+  var next = 0;
+  var deadline = Date.now() + duration;
+  var run = function() {
+    if (Date.now() >= deadline) return;
+    objects[next++ % keys].helloAsync({ louder: false }, function(err) {
+      if (err) throw err;
+      if (Date.now() < deadline) ++runs;
+      run();
+    });
+  };
+  for (var c = 0; c < argv.concurrency; c++) run();
+  setTimeout(function() {
+    process.stdout.write(JSON.stringify({ runs: runs }));
+    process.exit(0);
+  }, duration);
+} else {
+  var measure = function(label, use_cache) {
+    var args = [__filename, '--child', '--concurrency', argv.concurrency, '--duration', duration / 1000, '--keys', keys, '--cache', cache_file];
+    if (use_cache) args.push('--use-cache');
+    var out = child_process.execFileSync(process.execPath, args, { encoding: 'utf8' });
+    var runs = JSON.parse(out).runs;
+    var rate = runs / (duration / 1000);
+    console.log(label + ': ' + rate.toFixed(0) + ' runs/s (runs:' + runs + ' ms:' + duration + ' )');
+  };
+
+  if (fs.existsSync(cache_file)) fs.unlinkSync(cache_file);
+  measure('Without cache         ', false);
+  measure('With cache, cold start', true);
+  measure('With cache, warm start', true);
+  fs.unlinkSync(cache_file);
+
+  console.log('Benchmark duration:', duration / 1000, 's per run, keys:', keys, 'concurrency:', argv.concurrency);
+}
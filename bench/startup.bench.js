@@ -0,0 +1,72 @@
+"use strict";
+
+var argv = require('minimist')(process.argv.slice(2));
+if (argv.help) {
+  console.error('Measures require() time and memory, and time to the first call of each export, in fresh processes');
+  console.error('Example: \n\tnode bench/startup.bench.js --runs 20');
+  console.error('Optional args: \n\t--runs (fresh processes per export, default 20)');
+  process.exit(0);
+}
+
+var child_process = require('child_process');
+var bytes = require('bytes');
+
+var runs = argv.runs || 20;
+
+// How to make the first call of each export. Async exports are timed until
+// the call returns, not until the result arrives: that is all the startup
+// cost the export adds on the main thread.
+var first_calls = {
+  hello: function(m) { m.hello(); },
+  helloMany: function(m) { m.helloMany(1); },
+  helloAsync: function(m) { m.helloAsync({}, function() {}); },
+  helloPromise: function(m) { m.helloPromise(); },
+  configureBatching: function(m) { m.configureBatching(); },
+  HelloObject: function(m) { new m.HelloObject('bench').helloMethod(); },
+  HelloObjectAsync: function(m) { new m.HelloObjectAsync('bench').helloAsync({}, function() {}); }
+};
+
+var ms = function(start) {
+  return Number(process.hrtime.bigint() - start) / 1e6;
+};
+
+var median = function(values) {
+  var sorted = values.slice().sort(function(a, b) { return a - b; });
+  return sorted[Math.floor(sorted.length / 2)];
+};
+
+if (argv.child) {
+  var mem_start = process.memoryUsage();
+  var start = process.hrtime.bigint();
+  var module = require('../lib/index.js');
+  var require_ms = ms(start);
+  var mem = process.memoryUsage();
+
+  start = process.hrtime.bigint();
+  first_calls[argv.export](module);
+  var first_call_ms = ms(start);
+
+  process.stdout.write(JSON.stringify({
+    require_ms: require_ms,
+    rss: mem.rss - mem_start.rss,
+    heap: mem.heapUsed - mem_start.heapUsed,
+    first_call_ms: first_call_ms
+  }));
+  // don't wait for async exports to finish their work
+  process.exit(0);
+} else {
+  var all = [];
+  Object.keys(first_calls).forEach(function(name) {
+    var results = [];
+    for (var i = 0; i < runs; i++) {
+      var out = child_process.execFileSync(process.execPath, [__filename, '--child', '--export', name], { encoding: 'utf8' });
+      results.push(JSON.parse(out));
+    }
+    all = all.concat(results);
+    console.log('First call of ' + name + ': ' + median(results.map(function(r) { return r.first_call_ms; })).toFixed(3) + ' ms (median of ' + runs + ')');
+  });
+
+  console.log('require(): ' + median(all.map(function(r) { return r.require_ms; })).toFixed(3) + ' ms, ' +
+    'rss +' + bytes(median(all.map(function(r) { return r.rss; }))) + ', ' +
+    'heap +' + bytes(median(all.map(function(r) { return r.heap; }))) + ' (median of ' + all.length + ')');
+}
@@ -11,6 +11,9 @@
   'includes': [ 'common.gypi' ], # brings in a default set of options that are inherited from gyp
   'variables': { # custom variables we use specific to this file
       'error_on_warnings%':'true', # can be overriden by a command line variable because of the % sign using "WERROR" (defined in Makefile)
+      # Versions the result cache file (see src/object_async/result_cache.hpp),
+      # so that every build of the same release shares cached results
+      'package_version': "<!(node -p \"require('./package.json').version\")",
       # Use this variable to silence warnings from mason dependencies and from NAN
       # It's a variable to make easy to pass to
       # cflags (linux) and xcode (mac)
@@ -68,6 +71,12 @@
       'product_dir': '<(module_path)', # controls where the node binary file gets copied to (./lib/binding/module.node)
       'type': 'loadable_module',
       'dependencies': [ 'action_before_build' ],
+      'defines': [
+        # instance data (napi_set_instance_data) used by src/module_data.cpp
+        # needs N-API 6
+        'NAPI_VERSION=6',
+        'RESULT_CACHE_BUILD_ID="<(package_version)"'
+      ],
       # "make" only watches files specified here, and will sometimes cache these files after the first compile.
       # This cache can sometimes cause confusing errors when removing/renaming/adding new files.
       # Running "make clean" helps to prevent this "mysterious error by cache" scenario
@@ -75,11 +84,14 @@
       # See: https://github.com/mapbox/node-cpp-skel/pull/44#discussion_r122050205
       'sources': [
         './src/module.cpp',
+        './src/module_data.cpp',
+        './src/batching/batched_worker.cpp',
         './src/standalone/hello.cpp',
         './src/standalone_async/hello_async.cpp',
         './src/standalone_promise/hello_promise.cpp',
         './src/object_sync/hello.cpp',
-        './src/object_async/hello_async.cpp'
+        './src/object_async/hello_async.cpp',
+        './src/object_async/result_cache.cpp'
       ],
       'ldflags': [
         '-Wl,-z,now',
@@ -1,102 +1,145 @@
 "use strict";
 
-const {
-  hello,
-  helloAsync,
-  helloPromise,
-  HelloObject,
-  HelloObjectAsync
-} = require('./binding/module.node');
+// The binding's exports are resolved lazily: each starts out as an accessor
+// that builds the function or class on first access and then replaces itself
+// with a plain data property. Re-exporting the binding as is keeps that (and
+// keeps the exports writable, e.g. for stubbing in tests).
+module.exports = require('./binding/module.node');
 
-module.exports = {
-  /**
-   * This is a synchronous standalone function that logs a string.
-   * @name hello
-   * @returns {string}
-   * @example
-   * const { hello } = require('@mapbox/node-cpp-skel');
-   * const check = hello();
-   * console.log(check); // => "hello world"
-   */
-  hello,
+/**
+ * This is a synchronous standalone function that logs a string.
+ * @name hello
+ * @returns {string}
+ * @example
+ * const { hello } = require('@mapbox/node-cpp-skel');
+ * const check = hello();
+ * console.log(check); // => "hello world"
+ */
 
-  /**
-   * This is an asynchronous standalone function that logs a string.
-   * @name helloAsync
-   * @param {Object} args - different ways to alter the string
-   * @param {boolean} args.louder - adds exclamation points to the string
-   * @param {boolean} args.buffer - returns value as a node buffer rather than a string
-   * @param {Function} callback - from whence the hello comes, returns a string
-   * @returns {string}
-   * @example
-   * const { helloAsync } = require('@mapbox/node-cpp-skel');
-   * helloAsync({ louder: true }, function(err, result) {
-   *   if (err) throw err;
-   *   console.log(result); // => "...threads are busy async bees...hello
-   * world!!!!"
-   * });
-   */
-  helloAsync,
+/**
+ * This is a synchronous bulk variant of `hello`. All results are produced
+ * in a single native call and returned packed into one buffer, which is
+ * much cheaper than calling `hello` in a loop for small payloads.
+ * @name helloMany
+ * @param {Number} count - number of results to produce
+ * @returns {Object} `{ data: Buffer, offsets: Uint32Array }` where result `i`
+ * is `data.toString('utf8', offsets[i], offsets[i + 1])`
+ * @example
+ * const { helloMany } = require('@mapbox/node-cpp-skel');
+ * const { data, offsets } = helloMany(2);
+ * console.log(data.toString('utf8', offsets[1], offsets[2])); // => "hello world"
+ */
 
-  /**
-   * This is a function that returns a promise. It multiplies a string N times.
-   * @name helloPromise
-   * @param {Object} [options] - different ways to alter the string
-   * @param {string} [options.phrase=hello] - the string to multiply
-   * @param {Number} [options.multiply=1] - duplicate the string this number of times
-   * @returns {Promise}
-   * @example
-   * const { helloPromise } = require('@mapbox/node-cpp-skel');
-   * const result = await helloAsync({ phrase: 'Howdy', multiply: 3 });
-   * console.log(result); // HowdyHowdyHowdy
-   */
-  helloPromise,
+/**
+ * This is an asynchronous standalone function that logs a string.
+ * @name helloAsync
+ * @param {Object} args - different ways to alter the string
+ * @param {boolean} args.louder - adds exclamation points to the string
+ * @param {boolean} args.buffer - returns value as a node buffer rather than a string
+ * @param {Function} callback - from whence the hello comes, returns a string
+ * @returns {string}
+ * @example
+ * const { helloAsync } = require('@mapbox/node-cpp-skel');
+ * helloAsync({ louder: true }, function(err, result) {
+ *   if (err) throw err;
+ *   console.log(result); // => "...threads are busy async bees...hello
+ * world!!!!"
+ * });
+ */
 
-  /**
-   * Synchronous class, called HelloObject
-   * @class HelloObject
-   * @example
-   * const { HelloObject } = require('@mapbox/node-cpp-skel');
-   * const Obj = new HelloObject('greg');
-   */
+/**
+ * This is a function that returns a promise. It multiplies a string N times.
+ * @name helloPromise
+ * @param {Object} [options] - different ways to alter the string
+ * @param {string} [options.phrase=hello] - the string to multiply
+ * @param {Number} [options.multiply=1] - duplicate the string this number of times
+ * @returns {Promise}
+ * @example
+ * const { helloPromise } = require('@mapbox/node-cpp-skel');
+ * const result = await helloAsync({ phrase: 'Howdy', multiply: 3 });
+ * console.log(result); // HowdyHowdyHowdy
+ */
 
-  /**
-   * Say hello
-   *
-   * @name hello
-   * @memberof HelloObject
-   * @returns {String}
-   * @example
-   * const x = Obj.hello();
-   * console.log(x); // => '...initialized an object...hello greg'
-   */
-   HelloObject,
+/**
+ * Configures how completions of the asynchronous functions are delivered.
+ * Results computed in the threadpool are handed back to Javascript in
+ * batches, running many callbacks and promise resolutions per event loop
+ * turn instead of one. Settings apply to the current thread's environment.
+ * @name configureBatching
+ * @param {Object} [options]
+ * @param {boolean} [options.enabled=true] - when false, every completion is delivered on its own through a plain `Napi::AsyncWorker`
+ * @param {Number} [options.maxBatchSize=256] - maximum number of completions delivered per batch
+ * @param {Number} [options.maxLatency=0] - milliseconds a partial batch may wait for more completions
+ * @returns {Object} the current `{ enabled, maxBatchSize, maxLatency }` settings
+ * @example
+ * const { configureBatching } = require('@mapbox/node-cpp-skel');
+ * configureBatching({ maxBatchSize: 1024, maxLatency: 1 });
+ */
 
-  /**
-   * Asynchronous class, called HelloObjectAsync
-   * @class HelloObjectAsync
-   * @example
-   * const { HelloObjectAsync } = require('@mapbox/node-cpp-skel');
-   * const Obj = new module.HelloObjectAsync('greg');
-   */
+/**
+ * Synchronous class, called HelloObject
+ * @class HelloObject
+ * @example
+ * const { HelloObject } = require('@mapbox/node-cpp-skel');
+ * const Obj = new HelloObject('greg');
+ */
 
-  /**
-   * Say hello while doing expensive work in threads
-   *
-   * @name helloAsync
-   * @memberof HelloObjectAsync
-   * @param {Object} args - different ways to alter the string
-   * @param {boolean} args.louder - adds exclamation points to the string
-   * @param {buffer} args.buffer - returns object as a node buffer rather then string
-   * @param {Function} callback - from whence the hello comes, returns a string
-   * @returns {String}
-   * @example
-   * const { HelloObjectAsync } = require('@mapbox/node-cpp-skel');
-   * const Obj = new HelloObjectAsync('greg');
-   * Obj.helloAsync({ louder: true }, function(err, result) {
-   *   if (err) throw err;
-   *   console.log(result); // => '...threads are busy async bees...hello greg!!!'
-   * });
-   */
-   HelloObjectAsync
-};
\ No newline at end of file
+/**
+ * Say hello
+ *
+ * @name hello
+ * @memberof HelloObject
+ * @returns {String}
+ * @example
+ * const x = Obj.hello();
+ * console.log(x); // => '...initialized an object...hello greg'
+ */
+
+/**
+ * Say hello many times in a single synchronous call
+ *
+ * @name helloMany
+ * @memberof HelloObject
+ * @param {Number|Array<Object>} items - a count, or an array of options objects
+ * @param {boolean} [items[].louder] - adds exclamation points to that result
+ * @returns {Object} `{ data: Buffer, offsets: Uint32Array }` where result `i`
+ * is `data.toString('utf8', offsets[i], offsets[i + 1])`
+ * @example
+ * const { data, offsets } = Obj.helloMany([{}, { louder: true }]);
+ * console.log(data.toString('utf8', offsets[1], offsets[2])); // => 'greg!!!!'
+ */
+
+/**
+ * Asynchronous class, called HelloObjectAsync
+ * @class HelloObjectAsync
+ * @param {string} name
+ * @param {Object} [options]
+ * @param {Object} [options.cache] - persist results to a memory-mapped file so they survive restarts
+ * @param {string} options.cache.path - location of the cache file, shared by every object using the same options. The file is opened by the first `helloAsync` call. A file that cannot be opened or written to is ignored and results are computed as usual
+ * @param {string} [options.cache.buildId] - results cached under a different build id are discarded (defaults to the package version)
+ * @param {Number} [options.cache.maxBytes=67108864] - size of the cache file
+ * @param {Number} [options.cache.compactBytes=maxBytes/2] - once full, the cache is compacted down to its newest results fitting in this size, which must not be larger than `maxBytes`
+ * @example
+ * const { HelloObjectAsync } = require('@mapbox/node-cpp-skel');
+ * const Obj = new module.HelloObjectAsync('greg');
+ * const Cached = new module.HelloObjectAsync('greg', { cache: { path: '/tmp/hello.cache' } });
+ */
+
+/**
+ * Say hello while doing expensive work in threads
+ *
+ * @name helloAsync
+ * @memberof HelloObjectAsync
+ * @param {Object} args - different ways to alter the string
+ * @param {boolean} args.louder - adds exclamation points to the string
+ * @param {buffer} args.buffer - returns object as a node buffer rather then string
+ * @param {Function} callback - from whence the hello comes, returns a string
+ * @returns {String}
+ * @example
+ * const { HelloObjectAsync } = require('@mapbox/node-cpp-skel');
+ * const Obj = new HelloObjectAsync('greg');
+ * Obj.helloAsync({ louder: true }, function(err, result) {
+ *   if (err) throw err;
+ *   console.log(result); // => '...threads are busy async bees...hello greg!!!'
+ * });
+ */
@@ -0,0 +1,391 @@
+#include "batched_worker.hpp"
+#include "../module_data.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace batching {
+
+constexpr std::size_t CompletionQueue::kDefaultMaxBatchSize;
+
+// Runs a BatchedWorker through Napi::AsyncWorker, i.e. with one wakeup of the
+// event loop and one trip into Javascript per worker. Owns the worker.
+class UnbatchedWorker : public Napi::AsyncWorker
+{
+  public:
+    explicit UnbatchedWorker(BatchedWorker* worker)
+        : Napi::AsyncWorker(worker->Env(), "node-cpp-skel:BatchedWorker"),
+          worker_(worker) {}
+
+  protected:
+    void Execute() override
+    {
+        worker_->Run();
+    }
+
+    // Errors are kept in the wrapped worker, so this also reports them
+    void OnOK() override
+    {
+        worker_->Complete();
+    }
+
+  private:
+    std::unique_ptr<BatchedWorker> worker_;
+};
+
+BatchedWorker::BatchedWorker(Napi::Function const& callback)
+    : env_(callback.Env()),
+      callback_(Napi::Persistent(callback)),
+      context_(std::make_unique<AsyncResource>(env_, "node-cpp-skel:BatchedWorker")),
+      queue_(nullptr),
+      error_(),
+      next_(nullptr) {}
+
+BatchedWorker::BatchedWorker(Napi::Env const& env)
+    : env_(env),
+      callback_(),
+      context_(nullptr),
+      queue_(nullptr),
+      error_(),
+      next_(nullptr) {}
+
+void BatchedWorker::Queue()
+{
+    queue_ = CompletionQueue::Get(env_);
+    if (!queue_->Enabled())
+    {
+        queue_ = nullptr;
+        auto* worker = new UnbatchedWorker(this); // NOLINT
+        worker->Queue();
+        return;
+    }
+    queue_->Started();
+    auto* req = new uv_work_t; // NOLINT
+    req->data = this;
+    // The uv_work_t is freed on its own: the worker may already have been
+    // completed (and deleted) by the time libuv runs the after-work callback
+    uv_queue_work(queue_->loop_, req, OnExecute, [](uv_work_t* r, int /*status*/) {
+        delete r; // NOLINT
+    });
+}
+
+void BatchedWorker::OnExecute(uv_work_t* req)
+{
+    auto* self = static_cast<BatchedWorker*>(req->data);
+    self->Run();
+    // `self` belongs to the main thread as soon as it has been pushed, so keep
+    // our own reference to the queue
+    std::shared_ptr<CompletionQueue> queue = self->queue_;
+    queue->Push(self);
+}
+
+void BatchedWorker::Run()
+{
+    // The try/catch is critical here: if code was added that could throw an
+    // unhandled error INSIDE the threadpool, it would be disasterous
+    try
+    {
+        Execute();
+    }
+    catch (std::exception const& e)
+    {
+        SetError(e.what());
+    }
+}
+
+void BatchedWorker::Complete()
+{
+    if (error_.empty())
+    {
+        OnOK();
+    }
+    else
+    {
+        OnError(Napi::Error::New(env_, error_));
+    }
+}
+
+void BatchedWorker::OnOK()
+{
+    if (!callback_.IsEmpty())
+    {
+        callback_.Call(GetResult(env_));
+    }
+}
+
+void BatchedWorker::OnError(Napi::Error const& error)
+{
+    if (!callback_.IsEmpty())
+    {
+        callback_.Call({error.Value()});
+    }
+}
+
+std::vector<napi_value> BatchedWorker::GetResult(Napi::Env /*unused*/)
+{
+    return {};
+}
+
+void BatchedWorker::SetError(std::string const& error)
+{
+    error_ = error;
+}
+
+std::shared_ptr<CompletionQueue> CompletionQueue::Get(Napi::Env env)
+{
+    // Owned by the environment: tearing it down closes the queue's handles
+    auto& data = utils::ModuleData::Get(env);
+    if (!data.completions)
+    {
+        data.completions = std::make_shared<CompletionQueue>(env);
+    }
+    return data.completions;
+}
+
+CompletionQueue::CompletionQueue(Napi::Env env)
+    : env_(env),
+      loop_(nullptr),
+      async_(new uv_async_t), // NOLINT
+      timer_(new uv_timer_t), // NOLINT
+      context_(std::make_unique<AsyncResource>(env, "node-cpp-skel:CompletionQueue")),
+      inbox_(nullptr),
+      async_mutex_(),
+      ready_(),
+      pending_(0),
+      enabled_(true),
+      max_batch_size_(kDefaultMaxBatchSize),
+      max_latency_ms_(0),
+      timer_active_(false),
+      backlog_(false)
+{
+    NAPI_THROW_IF_FAILED_VOID(env, napi_get_uv_event_loop(env, &loop_));
+    uv_async_init(loop_, async_, OnAsync);
+    async_->data = this;
+    uv_timer_init(loop_, timer_);
+    timer_->data = this;
+    // Neither handle keeps the process alive on its own: async_ is only
+    // referenced while workers are in flight (see Started/Flush)
+    uv_unref(reinterpret_cast<uv_handle_t*>(async_)); // NOLINT
+    uv_unref(reinterpret_cast<uv_handle_t*>(timer_)); // NOLINT
+}
+
+void CompletionQueue::Configure(bool enabled, std::size_t max_batch_size, std::uint64_t max_latency_ms)
+{
+    enabled_ = enabled;
+    max_batch_size_ = max_batch_size;
+    max_latency_ms_ = max_latency_ms;
+}
+
+void CompletionQueue::Started()
+{
+    if (pending_++ == 0)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t*>(async_)); // NOLINT
+    }
+}
+
+void CompletionQueue::Push(BatchedWorker* worker)
+{
+    BatchedWorker* head = inbox_.load(std::memory_order_relaxed);
+    do
+    {
+        worker->next_ = head;
+    } while (!inbox_.compare_exchange_weak(head, worker, std::memory_order_release, std::memory_order_relaxed));
+
+    // A non-empty inbox already has a wakeup on its way
+    if (head == nullptr)
+    {
+        std::lock_guard<std::mutex> guard(async_mutex_);
+        if (async_ != nullptr)
+        {
+            uv_async_send(async_);
+        }
+    }
+}
+
+// Moves everything from the inbox to the (main thread only) ready queue
+void CompletionQueue::Collect()
+{
+    BatchedWorker* head = inbox_.exchange(nullptr, std::memory_order_acquire);
+    // the inbox is a stack: reverse it to deliver in completion order
+    BatchedWorker* reversed = nullptr;
+    while (head != nullptr)
+    {
+        BatchedWorker* next = head->next_;
+        head->next_ = reversed;
+        reversed = head;
+        head = next;
+    }
+    for (; reversed != nullptr; reversed = reversed->next_)
+    {
+        ready_.push_back(reversed);
+    }
+}
+
+void CompletionQueue::OnAsync(uv_async_t* handle)
+{
+    auto* self = static_cast<CompletionQueue*>(handle->data);
+    self->Collect();
+    if (self->backlog_ || self->max_latency_ms_ == 0 || self->ready_.size() >= self->max_batch_size_)
+    {
+        self->Flush();
+    }
+    else if (!self->timer_active_ && !self->ready_.empty())
+    {
+        self->timer_active_ = true;
+        uv_timer_start(self->timer_, OnTimer, self->max_latency_ms_, 0);
+    }
+}
+
+void CompletionQueue::OnTimer(uv_timer_t* handle)
+{
+    auto* self = static_cast<CompletionQueue*>(handle->data);
+    self->Collect();
+    self->Flush();
+}
+
+// Delivers one batch
+void CompletionQueue::Flush()
+{
+    if (timer_active_)
+    {
+        uv_timer_stop(timer_);
+        timer_active_ = false;
+    }
+    std::size_t const count = std::min(ready_.size(), max_batch_size_);
+    if (count > 0)
+    {
+        // One handle scope and one callback scope for the whole batch: the
+        // nextTicks and microtasks queued by its callbacks run once, when
+        // batch_scope closes. The nested scope of a worker with a callback
+        // only switches to the async context the worker was created in.
+        Napi::HandleScope scope(env_);
+        Napi::CallbackScope batch_scope(env_, *context_);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::unique_ptr<BatchedWorker> worker(ready_.front());
+            ready_.pop_front();
+            try
+            {
+                if (worker->context_)
+                {
+                    Napi::CallbackScope callback_scope(env_, *worker->context_);
+                    worker->Complete();
+                }
+                else
+                {
+                    worker->Complete();
+                }
+            }
+            catch (Napi::Error const& e)
+            {
+                // an exception thrown by a callback is reported as uncaught,
+                // just like it would be from Napi::AsyncWorker
+                napi_fatal_exception(env_, e.Value());
+            }
+        }
+        pending_ -= count;
+        if (pending_ == 0)
+        {
+            uv_unref(reinterpret_cast<uv_handle_t*>(async_)); // NOLINT
+        }
+    }
+    backlog_ = !ready_.empty();
+    if (backlog_)
+    {
+        uv_async_send(async_);
+    }
+}
+
+void CompletionQueue::Close()
+{
+    {
+        std::lock_guard<std::mutex> guard(async_mutex_);
+        uv_close(reinterpret_cast<uv_handle_t*>(async_), [](uv_handle_t* h) { // NOLINT
+            delete reinterpret_cast<uv_async_t*>(h);                         // NOLINT
+        });
+        async_ = nullptr;
+    }
+    uv_close(reinterpret_cast<uv_handle_t*>(timer_), [](uv_handle_t* h) { // NOLINT
+        delete reinterpret_cast<uv_timer_t*>(h);                         // NOLINT
+    });
+    timer_ = nullptr;
+    context_ = nullptr;
+
+    // Completed workers can still release their Javascript references.
+    // Workers still running on the threadpool are leaked: they finish after
+    // their environment is gone and can't safely touch it any more.
+    Collect();
+    for (BatchedWorker* worker : ready_)
+    {
+        delete worker; // NOLINT
+    }
+    ready_.clear();
+}
+
+Napi::Value configureBatching(Napi::CallbackInfo const& info)
+{
+    Napi::Env env = info.Env();
+    std::shared_ptr<CompletionQueue> queue = CompletionQueue::Get(env);
+    bool enabled = queue->Enabled();
+    std::size_t max_batch_size = queue->MaxBatchSize();
+    std::uint64_t max_latency = queue->MaxLatency();
+
+    if (!info[0].IsUndefined())
+    {
+        if (!info[0].IsObject())
+        {
+            Napi::TypeError::New(env, "options must be an object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object options = info[0].As<Napi::Object>();
+
+        // enabled must be a boolean
+        if (options.Has(Napi::String::New(env, "enabled")))
+        {
+            Napi::Value enabled_val = options.Get(Napi::String::New(env, "enabled"));
+            if (!enabled_val.IsBoolean())
+            {
+                Napi::TypeError::New(env, "option 'enabled' must be a boolean").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            enabled = enabled_val.As<Napi::Boolean>().Value();
+        }
+
+        // maxBatchSize must be an integer >= 1
+        if (options.Has(Napi::String::New(env, "maxBatchSize")))
+        {
+            Napi::Value max_batch_size_val = options.Get(Napi::String::New(env, "maxBatchSize"));
+            if (!max_batch_size_val.IsNumber() || max_batch_size_val.As<Napi::Number>().Int64Value() < 1)
+            {
+                Napi::TypeError::New(env, "option 'maxBatchSize' must be 1 or greater").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            max_batch_size = static_cast<std::size_t>(max_batch_size_val.As<Napi::Number>().Int64Value());
+        }
+
+        // maxLatency (milliseconds) must be an integer >= 0
+        if (options.Has(Napi::String::New(env, "maxLatency")))
+        {
+            Napi::Value max_latency_val = options.Get(Napi::String::New(env, "maxLatency"));
+            if (!max_latency_val.IsNumber() || max_latency_val.As<Napi::Number>().Int64Value() < 0)
+            {
+                Napi::TypeError::New(env, "option 'maxLatency' must be 0 or greater").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            max_latency = static_cast<std::uint64_t>(max_latency_val.As<Napi::Number>().Int64Value());
+        }
+    }
+
+    queue->Configure(enabled, max_batch_size, max_latency);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("enabled", Napi::Boolean::New(env, enabled));
+    result.Set("maxBatchSize", Napi::Number::New(env, static_cast<double>(max_batch_size)));
+    result.Set("maxLatency", Napi::Number::New(env, static_cast<double>(max_latency)));
+    return result;
+}
+
+} // namespace batching
@@ -0,0 +1,189 @@
+#pragma once
+#include <napi.h>
+#include <uv.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace batching {
+
+class CompletionQueue;
+class UnbatchedWorker;
+
+/**
+ * An async context along with the resource object it was created for.
+ *
+ * Node-API only holds the resource weakly: once it has been garbage
+ * collected, callback scopes opened with the context lose track of it and
+ * AsyncLocalStorage stores read as undefined. Napi::AsyncContext doesn't
+ * keep its default resource alive, so this does.
+ */
+class AsyncResource
+{
+  public:
+    AsyncResource(Napi::Env env, char const* name)
+        : resource_(Napi::Persistent(Napi::Object::New(env))),
+          context_(env, name, resource_.Value()) {}
+
+    operator napi_async_context() const { return context_; }
+
+  private:
+    // declared first, so that it outlives the context
+    Napi::ObjectReference resource_;
+    Napi::AsyncContext context_;
+};
+
+/**
+ * BatchedWorker is a drop-in replacement for Napi::AsyncWorker.
+ *
+ * Execute() still runs on the libuv threadpool, but instead of every worker
+ * waking up the event loop and entering Javascript on its own, finished
+ * workers are pushed onto their environment's CompletionQueue. The queue then
+ * runs OnOK()/OnError() for many workers at once, under a single
+ * Napi::HandleScope and a single callback scope, so nextTicks and microtasks
+ * are processed once per batch rather than once per worker. Inside it, each
+ * worker with a callback enters the async context captured when it was
+ * created, so async_hooks and AsyncLocalStorage see the same context as with
+ * Napi::AsyncWorker. Workers without one (e.g. ones that resolve a promise)
+ * complete straight in the batch's scope: promise continuations already run
+ * in the context they were created in.
+ *
+ * Like Napi::AsyncWorker, a queued worker deletes itself once completed.
+ *
+ * With batching disabled (see configureBatching), workers are run through a
+ * plain Napi::AsyncWorker instead, which is mostly useful as a baseline for
+ * benchmarks.
+ */
+class BatchedWorker
+{
+  public:
+    // `callback` is called in the async context the worker was created in
+    explicit BatchedWorker(Napi::Function const& callback);
+    // For workers that don't call into Javascript when completed, e.g. ones
+    // resolving a promise: they don't need an async context of their own
+    explicit BatchedWorker(Napi::Env const& env);
+    virtual ~BatchedWorker() = default;
+
+    BatchedWorker(BatchedWorker const&) = delete;
+    BatchedWorker& operator=(BatchedWorker const&) = delete;
+
+    // Hands the worker over to the threadpool
+    void Queue();
+
+    Napi::Env Env() const { return env_; }
+    Napi::FunctionReference& Callback() { return callback_; }
+
+  protected:
+    // Runs on the threadpool: no access to Javascript objects here
+    virtual void Execute() = 0;
+
+    // Run on the main thread, in a batch, once Execute() has returned.
+    // The defaults match Napi::AsyncWorker: call the callback with the
+    // values from GetResult() or with the error.
+    virtual void OnOK();
+    virtual void OnError(Napi::Error const& error);
+    virtual std::vector<napi_value> GetResult(Napi::Env env);
+
+    void SetError(std::string const& error);
+
+  private:
+    friend class CompletionQueue;
+    friend class UnbatchedWorker;
+
+    static void OnExecute(uv_work_t* req);
+    void Run();
+    void Complete();
+
+    Napi::Env env_;
+    Napi::FunctionReference callback_;
+    // only created for workers with a callback, see the constructors
+    std::unique_ptr<AsyncResource> context_;
+    std::shared_ptr<CompletionQueue> queue_;
+    std::string error_;
+    // intrusive link used by CompletionQueue's inbox
+    BatchedWorker* next_;
+};
+
+/**
+ * CompletionQueue collects finished BatchedWorkers for one environment.
+ *
+ * - Threadpool threads push workers onto a lock-free multi-producer inbox
+ *   (a linked stack swapped out as a whole by the main thread). Only the push
+ *   that finds the inbox empty wakes up the event loop, so bursts of
+ *   completions cost a single uv_async_send.
+ * - On the main thread, completions are delivered in batches of at most
+ *   `max_batch_size`, sharing one Napi::HandleScope and one callback scope.
+ *   A worker with a callback runs in a nested callback scope for its own
+ *   async context: closing a nested scope only restores the context, the
+ *   nextTick and microtask queues are drained once the batch's scope closes.
+ *   Any remainder is delivered on the next loop turn so that other I/O is
+ *   not starved.
+ * - With `max_latency_ms` > 0, a partial batch waits up to that long for
+ *   more completions before being delivered.
+ */
+class CompletionQueue
+{
+  public:
+    static constexpr std::size_t kDefaultMaxBatchSize = 256;
+
+    // Returns the queue for `env`, creating it on first use. Must be called
+    // from the main thread.
+    static std::shared_ptr<CompletionQueue> Get(Napi::Env env);
+
+    explicit CompletionQueue(Napi::Env env);
+    ~CompletionQueue() = default;
+
+    CompletionQueue(CompletionQueue const&) = delete;
+    CompletionQueue& operator=(CompletionQueue const&) = delete;
+
+    void Configure(bool enabled, std::size_t max_batch_size, std::uint64_t max_latency_ms);
+    bool Enabled() const { return enabled_; }
+    std::size_t MaxBatchSize() const { return max_batch_size_; }
+    std::uint64_t MaxLatency() const { return max_latency_ms_; }
+
+    // Closes the handles; called when the environment is torn down
+    void Close();
+
+  private:
+    friend class BatchedWorker;
+
+    // main thread
+    void Started();
+    void Collect();
+    void Flush();
+    static void OnAsync(uv_async_t* handle);
+    static void OnTimer(uv_timer_t* handle);
+
+    // any thread
+    void Push(BatchedWorker* worker);
+
+    Napi::Env env_;
+    uv_loop_t* loop_;
+    uv_async_t* async_;
+    uv_timer_t* timer_;
+
+    // async context of the batches themselves, destroyed by Close()
+    std::unique_ptr<AsyncResource> context_;
+    std::atomic<BatchedWorker*> inbox_;
+    // guards async_ against being closed while a worker thread signals it
+    std::mutex async_mutex_;
+
+    std::deque<BatchedWorker*> ready_;
+    std::size_t pending_;
+    bool enabled_;
+    std::size_t max_batch_size_;
+    std::uint64_t max_latency_ms_;
+    bool timer_active_;
+    bool backlog_;
+};
+
+// configureBatching, sync method
+// sets enabled / maxBatchSize / maxLatency and returns the current settings
+Napi::Value configureBatching(Napi::CallbackInfo const& info);
+
+} // namespace batching
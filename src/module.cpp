@@ -1,41 +1,159 @@
+#include "batching/batched_worker.hpp"
+#include "module_data.hpp"
 #include "object_async/hello_async.hpp"
 #include "object_sync/hello.hpp"
 #include "standalone/hello.hpp"
 #include "standalone_async/hello_async.hpp"
 #include "standalone_promise/hello_promise.hpp"
+#include <cstddef>
 #include <napi.h>
+#include <vector>
 // #include "your_code.hpp"
 
-Napi::Object init(Napi::Env env, Napi::Object exports)
+namespace {
+
+// Every export is defined lazily: `require()` only installs an accessor for
+// each name, and the function or class is built the first time the getter
+// runs. The getter then replaces itself with a plain (writable, configurable)
+// data property, so later accesses are ordinary property reads, and exports
+// can be reassigned or stubbed like any other property. Environments (worker
+// threads) that never touch an export don't pay for it.
+struct Export
 {
-    // expose hello method
-    exports.Set(Napi::String::New(env, "hello"), Napi::Function::New(env, standalone::hello));
+    char const* name;
+    Napi::Function (*define)(Napi::Env env);
+};
 
-    // expose helloAsync method
-    exports.Set(Napi::String::New(env, "helloAsync"), Napi::Function::New(env, standalone_async::helloAsync));
+Napi::Function DefineHello(Napi::Env env)
+{
+    return Napi::Function::New(env, standalone::hello, "hello");
+}
 
-    // expose helloPromise method
-    exports.Set(Napi::String::New(env, "helloPromise"), Napi::Function::New(env, standalone_promise::helloPromise));
+Napi::Function DefineHelloMany(Napi::Env env)
+{
+    return Napi::Function::New(env, standalone::helloMany, "helloMany");
+}
 
-    // expose HelloObject class
-    object_sync::HelloObject::Init(env, exports);
+Napi::Function DefineHelloAsync(Napi::Env env)
+{
+    return Napi::Function::New(env, standalone_async::helloAsync, "helloAsync");
+}
+
+Napi::Function DefineHelloPromise(Napi::Env env)
+{
+    return Napi::Function::New(env, standalone_promise::helloPromise, "helloPromise");
+}
 
+Napi::Function DefineConfigureBatching(Napi::Env env)
+{
+    return Napi::Function::New(env, batching::configureBatching, "configureBatching");
+}
+
+Export const exports_table[] = {
+    // expose hello method
+    {"hello", DefineHello},
+    // expose helloMany method
+    {"helloMany", DefineHelloMany},
+    // expose helloAsync method
+    {"helloAsync", DefineHelloAsync},
+    // expose helloPromise method
+    {"helloPromise", DefineHelloPromise},
+    // expose configureBatching method
+    {"configureBatching", DefineConfigureBatching},
+    // expose HelloObject class
+    {"HelloObject", object_sync::HelloObject::Define},
     // expose HelloObjectAsync class
-    object_async::HelloObjectAsync::Init(env, exports);
+    {"HelloObjectAsync", object_async::HelloObjectAsync::Define},
+};
+
+constexpr std::size_t exports_count = sizeof(exports_table) / sizeof(exports_table[0]);
+
+constexpr napi_property_attributes export_attributes =
+    static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable);
+
+// Replaces the accessor on `receiver` with a data property holding `value`.
+// This only saves later reads a trip through the accessor, so it is skipped
+// when it can't be done: the receiver may not be an object (e.g. through
+// Reflect.get), or the exports may have been frozen or sealed before their
+// first read. The status is checked by hand rather than through
+// Object::DefineProperty, which would build a Napi::Error on every read of a
+// frozen export.
+void SetExportValue(Napi::Value receiver, Export const* entry, Napi::Value value)
+{
+    if (!receiver.IsObject())
+    {
+        return;
+    }
+    napi_env env = receiver.Env();
+    Napi::PropertyDescriptor const property = Napi::PropertyDescriptor::Value(entry->name, value, export_attributes);
+    napi_property_descriptor const& descriptor = property;
+    if (napi_define_properties(env, receiver, 1, &descriptor) != napi_ok)
+    {
+        bool pending = false;
+        napi_is_exception_pending(env, &pending);
+        if (pending)
+        {
+            napi_value error = nullptr;
+            napi_get_and_clear_last_exception(env, &error);
+        }
+    }
+}
+
+Napi::Value GetExport(Napi::CallbackInfo const& info)
+{
+    auto const* entry = static_cast<Export const*>(info.Data());
+    // The function (or class constructor) is also kept by slot in the
+    // environment's ModuleData. The accessor can still be reached through
+    // another receiver (e.g. an object inheriting from the exports), and
+    // defining a class twice would hand out two different constructors.
+    std::vector<Napi::FunctionReference>& exports = utils::ModuleData::Get(info.Env()).exports;
+    if (exports.empty())
+    {
+        exports.resize(exports_count);
+    }
+    Napi::FunctionReference& ref = exports[static_cast<std::size_t>(entry - exports_table)];
+    if (ref.IsEmpty())
+    {
+        ref = Napi::Persistent(entry->define(info.Env()));
+    }
+    Napi::Function value = ref.Value();
+    SetExportValue(info.This(), entry, value);
+    return value;
+}
+
+// Assigning an export before it was ever read just replaces the accessor
+// (and, like the read, does nothing on frozen exports)
+void SetExport(Napi::CallbackInfo const& info)
+{
+    SetExportValue(info.This(), static_cast<Export const*>(info.Data()), info[0]);
+}
+
+} // namespace
+
+Napi::Object init(Napi::Env /*env*/, Napi::Object exports)
+{
+    std::vector<Napi::PropertyDescriptor> properties;
+    for (auto const& entry : exports_table)
+    {
+        properties.push_back(Napi::PropertyDescriptor::Accessor<GetExport, SetExport>(
+            entry.name, static_cast<napi_property_attributes>(napi_enumerable | napi_configurable), const_cast<Export*>(&entry))); // NOLINT
+    }
+    exports.DefineProperties(properties);
 
     return exports;
     /**
    * You may have noticed there are multiple "hello" functions as part of this
    * module.
    * They are exposed a bit differently.
-   * 1) standalone::hello    // exposed above
+   * 1) standalone::hello    // exposed via exports_table above
    * 2) HelloObject.hello    // exposed in object_sync/hello.cpp as part of
    * HelloObject
    */
 
     // add more methods/classes below that youd like to use in Javascript world
     // then create a directory in /src with a .cpp and a .hpp file.
-    // Include your .hpp file at the top of this file.
+    // Include your .hpp file at the top of this file and add an entry
+    // to exports_table.
 }
 
 // Initialize the module (we only do this once)
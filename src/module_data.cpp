@@ -0,0 +1,29 @@
+#include "module_data.hpp"
+#include "batching/batched_worker.hpp"
+
+namespace utils {
+
+ModuleData& ModuleData::Get(Napi::Env env)
+{
+    auto* data = env.GetInstanceData<ModuleData>();
+    if (data == nullptr)
+    {
+        data = new ModuleData(); // NOLINT
+        env.SetInstanceData(data);
+    }
+    return *data;
+}
+
+ModuleData::ModuleData()
+    : exports(),
+      completions(nullptr) {}
+
+ModuleData::~ModuleData()
+{
+    if (completions)
+    {
+        completions->Close();
+    }
+}
+
+} // namespace utils
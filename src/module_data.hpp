@@ -0,0 +1,36 @@
+#pragma once
+#include <napi.h>
+
+#include <memory>
+#include <vector>
+
+namespace batching {
+class CompletionQueue;
+} // namespace batching
+
+namespace utils {
+
+/*
+* Per-environment state of the module. Every thread that loads the module
+* (the main thread and each worker thread) gets its own, stored as the
+* environment's instance data and destroyed along with the environment.
+* Everything in here is created lazily, on first use.
+*/
+struct ModuleData
+{
+    // Returns the data for `env`, creating it on first use
+    static ModuleData& Get(Napi::Env env);
+
+    ModuleData();
+    ~ModuleData();
+    ModuleData(ModuleData const&) = delete;
+    ModuleData& operator=(ModuleData const&) = delete;
+
+    // exported functions and class constructors, indexed by their slot in
+    // module.cpp's exports table
+    std::vector<Napi::FunctionReference> exports;
+    // see batching::CompletionQueue::Get
+    std::shared_ptr<batching::CompletionQueue> completions;
+};
+
+} // namespace utils
@@ -1,7 +1,20 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <napi.h>
+#include <new>
 #include <string>
+#include <vector>
+
+namespace gsl {
+template <typename T>
+using owner = T;
+} // namespace gsl
+
+// ^^^ type alias required for clang-tidy (cppcoreguidelines-owning-memory)
 
 namespace utils {
 
@@ -21,11 +34,115 @@ inline Napi::Value CallbackError(Napi::Env env, std::string const& message, Napi
     return func.Call({obj});
 }
 
-} // namespace utils
+/*
+* PackedResults accumulates many small string results into a single buffer so
+* that a synchronous "many" method can hand all of them back to Javascript in
+* one crossing. The result object looks like:
+*
+*   { data: Buffer, offsets: Uint32Array }
+*
+* where item `i` lives in `data` between `offsets[i]` and `offsets[i + 1]`.
+* Because the offsets are 32-bit, the packed data is capped at 4GB. Reserve()
+* also caps the offsets table and data together at 4GB, so a huge count fails
+* up front instead of attempting a huge allocation. Reserve() and Append()
+* return false once a limit would be exceeded or memory runs out.
+*/
+class PackedResults
+{
+  public:
+    PackedResults()
+        : data_(std::make_unique<std::vector<char>>()),
+          offsets_(1, 0) {}
 
-namespace gsl {
-template <typename T>
-using owner = T;
-} // namespace gsl
+    // Pre-allocate room for `count` items of `item_size` bytes each
+    bool Reserve(std::size_t count, std::size_t item_size)
+    {
+        std::size_t const per_item = sizeof(std::uint32_t) + item_size;
+        if (item_size > kMaxSize || count >= kMaxSize / per_item)
+        {
+            return false;
+        }
+        try
+        {
+            offsets_.reserve(count + 1);
+            data_->reserve(count * item_size);
+        }
+        catch (std::bad_alloc const&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool Append(std::string const& item)
+    {
+        if (item.size() > kMaxSize - data_->size())
+        {
+            return false;
+        }
+        try
+        {
+            data_->insert(data_->end(), item.begin(), item.end());
+            offsets_.push_back(static_cast<std::uint32_t>(data_->size()));
+        }
+        catch (std::bad_alloc const&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    Napi::Object Finish(Napi::Env env)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        if (data_->empty())
+        {
+            result.Set("data", Napi::Buffer<char>::New(env, 0));
+        }
+        else
+        {
+            char* data = data_->data();
+            std::size_t size = data_->size();
+            result.Set("data", Napi::Buffer<char>::New(
+                                   env,
+                                   data,
+                                   size,
+                                   [](Napi::Env /*unused*/, char* /*unused*/, gsl::owner<std::vector<char>*> v) {
+                                       delete v;
+                                   },
+                                   data_.release()));
+        }
+        Napi::Uint32Array offsets = Napi::Uint32Array::New(env, offsets_.size());
+        std::copy(offsets_.begin(), offsets_.end(), offsets.Data());
+        result.Set("offsets", offsets);
+        return result;
+    }
+
+  private:
+    static constexpr std::size_t kMaxSize = std::numeric_limits<std::uint32_t>::max();
+    std::unique_ptr<std::vector<char>> data_;
+    std::vector<std::uint32_t> offsets_;
+};
+
+/*
+* Reads the `count` argument of the synchronous "many" methods. Throws a
+* TypeError into Javascript land and returns false if it is not a
+* non-negative integer.
+*/
+inline bool GetCount(Napi::Env env, Napi::Value const& value, std::size_t& count)
+{
+    if (value.IsNumber())
+    {
+        double const num = value.As<Napi::Number>().DoubleValue();
+        if (num >= 0 && num <= static_cast<double>(std::numeric_limits<std::uint32_t>::max()) && !(num > std::floor(num)))
+        {
+            count = static_cast<std::size_t>(num);
+            return true;
+        }
+    }
+    Napi::TypeError::New(env, "count must be a non-negative integer").ThrowAsJavaScriptException();
+    return false;
+}
+
+} // namespace utils
 
-// ^^^ type alias required for clang-tidy (cppcoreguidelines-owning-memory)
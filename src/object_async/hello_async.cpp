@@ -1,7 +1,9 @@
 #include "hello_async.hpp"
+#include "../batching/batched_worker.hpp"
 #include "../cpu_intensive_task.hpp"
 #include "../module_utils.hpp"
 
+#include <cstdint>
 #include <exception>
 #include <map>
 #include <memory>
@@ -13,9 +15,9 @@
 namespace object_async {
 
 /*
-struct AsyncHelloWorker : Napi::AsyncWorker
+struct AsyncHelloWorker : batching::BatchedWorker
 {
-    using Base = Napi::AsyncWorker;
+    using Base = batching::BatchedWorker;
     // ctor
     AsyncHelloWorker(bool louder,
                      bool buffer,
@@ -83,24 +85,45 @@ struct AsyncHelloWorker : Napi::AsyncWorker
 // passed to the Callback invoked by the default OnOK() implementation.
 // Above is alternative implementation with OnOK() method calling
 // Callback with appropriate args. Both implementations use default OnError().
-struct AsyncHelloWorker_v2 : Napi::AsyncWorker
+struct AsyncHelloWorker_v2 : batching::BatchedWorker
 {
-    using Base = Napi::AsyncWorker;
+    using Base = batching::BatchedWorker;
     // ctor
     AsyncHelloWorker_v2(bool louder,
                         bool buffer,
                         std::string name,
+                        std::shared_ptr<ResultCache> cache,
                         Napi::Function const& cb)
         : Base(cb),
           louder_(louder),
           buffer_(buffer),
-          name_(std::move(name)) {}
+          name_(std::move(name)),
+          cache_(std::move(cache)),
+          key_(name_ + '\0' + (louder_ ? '1' : '0')) {}
 
     // The Execute() function is getting called when the worker starts to run.
     // - You only have access to member variables stored in this worker.
     // - You do not have access to Javascript v8 objects here.
     void Execute() override
     {
+        // The cache is only a shortcut: one that can't be read (e.g. a file
+        // that can't be opened) must not fail the request either, the
+        // result is computed as if there was no cache
+        bool cached = false;
+        if (cache_)
+        {
+            try
+            {
+                cached = cache_->Get(key_, cached_);
+            }
+            catch (std::exception const& /*unused*/)
+            {
+            }
+        }
+        if (cached)
+        {
+            return;
+        }
         try
         {
             result_ = detail::do_expensive_work(name_, louder_);
@@ -108,11 +131,35 @@ struct AsyncHelloWorker_v2 : Napi::AsyncWorker
         catch (std::exception const& e)
         {
             SetError(e.what());
+            return;
+        }
+        if (cache_)
+        {
+            // A cache that can't be written to (e.g. a full disk) must not
+            // fail the request, the result is still good
+            try
+            {
+                cache_->Put(key_, *result_);
+            }
+            catch (std::exception const& /*unused*/)
+            {
+            }
         }
     }
 
     std::vector<napi_value> GetResult(Napi::Env env) override
     {
+        if (cached_.data != nullptr)
+        {
+            // Buffers are writable from Javascript, so they get their own
+            // copy: pointing them into the shared mapping would let a write
+            // corrupt the cache file for every process using it
+            if (buffer_)
+            {
+                return {env.Null(), Napi::Buffer<char>::Copy(env, cached_.data, cached_.size)};
+            }
+            return {env.Null(), Napi::String::New(env, cached_.data, cached_.size)};
+        }
         if (result_)
         {
             if (buffer_)
@@ -138,16 +185,37 @@ struct AsyncHelloWorker_v2 : Napi::AsyncWorker
     bool const louder_;
     bool const buffer_;
     std::string const name_;
+    std::shared_ptr<ResultCache> const cache_;
+    // results depend on the name and the "louder" option only
+    std::string const key_;
+    CachedValue cached_{};
 };
 
-Napi::FunctionReference HelloObjectAsync::constructor; // NOLINT
+namespace {
+
+// Sizes must be whole numbers: Int64Value() would silently truncate 1.5 to 1
+bool is_positive_integer(Napi::Value const& value)
+{
+    if (!value.IsNumber())
+    {
+        return false;
+    }
+    double const number = value.As<Napi::Number>().DoubleValue();
+    if (!(number >= 1 && number <= 9007199254740991.0)) // Number.MAX_SAFE_INTEGER, also rejects NaN
+    {
+        return false;
+    }
+    return !(static_cast<double>(static_cast<std::int64_t>(number)) < number);
+}
+
+} // namespace
 
 HelloObjectAsync::HelloObjectAsync(Napi::CallbackInfo const& info)
     : Napi::ObjectWrap<HelloObjectAsync>(info)
 {
     Napi::Env env = info.Env();
     std::size_t length = info.Length();
-    if (length != 1 || !info[0].IsString())
+    if (length < 1 || length > 2 || !info[0].IsString())
     {
         Napi::TypeError::New(env, "String expected").ThrowAsJavaScriptException();
         return;
@@ -159,6 +227,81 @@ HelloObjectAsync::HelloObjectAsync(Napi::CallbackInfo const& info)
     if (name_.empty())
     {
         Napi::TypeError::New(env, "arg must be a non-empty string").ThrowAsJavaScriptException();
+        return;
+    }
+    if (length == 2 && !info[1].IsUndefined())
+    {
+        if (!info[1].IsObject())
+        {
+            Napi::TypeError::New(env, "second arg 'options' must be an object").ThrowAsJavaScriptException();
+            return;
+        }
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has(Napi::String::New(env, "cache")))
+        {
+            Napi::Value cache_val = options.Get(Napi::String::New(env, "cache"));
+            if (!cache_val.IsObject())
+            {
+                Napi::TypeError::New(env, "option 'cache' must be an object").ThrowAsJavaScriptException();
+                return;
+            }
+            Napi::Object cache = cache_val.As<Napi::Object>();
+            CacheOptions cache_options;
+
+            Napi::Value path_val = cache.Get(Napi::String::New(env, "path"));
+            if (!path_val.IsString() || path_val.As<Napi::String>().Utf8Value().empty())
+            {
+                Napi::TypeError::New(env, "option 'cache.path' must be a non-empty string").ThrowAsJavaScriptException();
+                return;
+            }
+            cache_options.path = path_val.As<Napi::String>();
+
+            if (cache.Has(Napi::String::New(env, "buildId")))
+            {
+                Napi::Value build_id_val = cache.Get(Napi::String::New(env, "buildId"));
+                if (!build_id_val.IsString())
+                {
+                    Napi::TypeError::New(env, "option 'cache.buildId' must be a string").ThrowAsJavaScriptException();
+                    return;
+                }
+                cache_options.build_id = build_id_val.As<Napi::String>();
+            }
+            if (cache.Has(Napi::String::New(env, "maxBytes")))
+            {
+                Napi::Value max_bytes_val = cache.Get(Napi::String::New(env, "maxBytes"));
+                if (!is_positive_integer(max_bytes_val))
+                {
+                    Napi::TypeError::New(env, "option 'cache.maxBytes' must be a positive integer").ThrowAsJavaScriptException();
+                    return;
+                }
+                cache_options.max_bytes = static_cast<std::size_t>(max_bytes_val.As<Napi::Number>().Int64Value());
+            }
+            if (cache.Has(Napi::String::New(env, "compactBytes")))
+            {
+                Napi::Value compact_bytes_val = cache.Get(Napi::String::New(env, "compactBytes"));
+                if (!is_positive_integer(compact_bytes_val))
+                {
+                    Napi::TypeError::New(env, "option 'cache.compactBytes' must be a positive integer").ThrowAsJavaScriptException();
+                    return;
+                }
+                cache_options.compact_bytes = static_cast<std::size_t>(compact_bytes_val.As<Napi::Number>().Int64Value());
+                if (cache_options.compact_bytes > cache_options.max_bytes)
+                {
+                    Napi::TypeError::New(env, "option 'cache.compactBytes' must not be larger than 'cache.maxBytes'").ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+
+            try
+            {
+                cache_ = ResultCache::Open(cache_options);
+            }
+            catch (std::exception const& e)
+            {
+                Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+                return;
+            }
+        }
     }
 }
 
@@ -206,24 +349,17 @@ Napi::Value HelloObjectAsync::helloAsync(Napi::CallbackInfo const& info)
         buffer = buffer_val.As<Napi::Boolean>().Value();
     }
 
-    auto* worker = new AsyncHelloWorker_v2{louder, buffer, name_, callback}; // NOLINT
+    auto* worker = new AsyncHelloWorker_v2{louder, buffer, name_, cache_, callback}; // NOLINT
     worker->Queue();
     return info.Env().Undefined(); // NOLINT
 }
 
-Napi::Object HelloObjectAsync::Init(Napi::Env env, Napi::Object exports)
+// Defines the class for `env`. It is called once per environment, the first
+// time the class is accessed (see module.cpp), which also keeps a persistent
+// reference to the constructor for as long as the environment lives.
+Napi::Function HelloObjectAsync::Define(Napi::Env env)
 {
-    Napi::Function func = DefineClass(env, "HelloObjectAsync", {InstanceMethod("helloAsync", &HelloObjectAsync::helloAsync)});
-    // Create a peristent reference to the class constructor. This will allow
-    // a function called on a class prototype and a function
-    // called on instance of a class to be distinguished from each other.
-    constructor = Napi::Persistent(func);
-    // Call the SuppressDestruct() method on the static data prevent the calling
-    // to this destructor to reset the reference when the environment is no longer
-    // available.
-    constructor.SuppressDestruct();
-    exports.Set("HelloObjectAsync", func);
-    return exports;
+    return DefineClass(env, "HelloObjectAsync", {InstanceMethod("helloAsync", &HelloObjectAsync::helloAsync)});
 }
 
 } // namespace object_async
@@ -1,4 +1,7 @@
 #pragma once
+#include "result_cache.hpp"
+
+#include <memory>
 #include <napi.h>
 
 namespace object_async {
@@ -14,14 +17,15 @@ class HelloObjectAsync : public Napi::ObjectWrap<HelloObjectAsync>
 {
   public:
     // initializer
-    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::Function Define(Napi::Env env);
     explicit HelloObjectAsync(Napi::CallbackInfo const& info);
     Napi::Value helloAsync(Napi::CallbackInfo const& info);
 
   private:
     // member variable
     // specific to each instance of the class
-    static Napi::FunctionReference constructor;
     std::string name_ = "";
+    // optional persistent cache of results, shared with the workers
+    std::shared_ptr<ResultCache> cache_ = nullptr;
 };
 } // namespace object_async
@@ -0,0 +1,658 @@
+#include "result_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace object_async {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'K', 'E', 'L', 'R', 'C', '0', '1'};
+
+// Layout of the first bytes of the cache file
+struct FileHeader
+{
+    char magic[8];
+    std::uint64_t build_id;
+    // offset one past the last committed record
+    std::uint64_t end;
+    // non-zero once the file has been replaced by a compacted copy
+    std::uint64_t stale;
+};
+
+// Every record is `RecordHeader | key | value | padding to 8 bytes`
+struct RecordHeader
+{
+    std::uint64_t hash;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+};
+
+constexpr std::size_t kFirstRecord = sizeof(FileHeader);
+
+std::uint64_t fnv1a(char const* data, std::size_t size)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::size_t record_size(std::size_t key_size, std::size_t value_size)
+{
+    std::size_t const size = sizeof(RecordHeader) + key_size + value_size;
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+std::runtime_error system_error(std::string const& what, std::string const& path)
+{
+    return std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+}
+
+void lock_file(int fd, int operation)
+{
+    while (::flock(fd, operation) != 0 && errno == EINTR)
+    {
+    }
+}
+
+// Closes a file descriptor when it goes out of scope, unless ownership has
+// been handed over with release()
+class FileDescriptor
+{
+  public:
+    explicit FileDescriptor(int fd)
+        : fd_(fd) {}
+    ~FileDescriptor()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+    FileDescriptor(FileDescriptor const&) = delete;
+    FileDescriptor& operator=(FileDescriptor const&) = delete;
+
+    int get() const { return fd_; }
+    int release()
+    {
+        int const fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+  private:
+    int fd_;
+};
+
+// Holds an exclusive flock() on a file descriptor that is private to the
+// calling thread, for the lifetime of the object
+class FileLock
+{
+  public:
+    explicit FileLock(int fd)
+        : fd_(fd)
+    {
+        lock_file(fd_, LOCK_EX);
+    }
+    ~FileLock() { ::flock(fd_, LOCK_UN); }
+    FileLock(FileLock const&) = delete;
+    FileLock& operator=(FileLock const&) = delete;
+
+  private:
+    int const fd_;
+};
+
+} // namespace
+
+// Owns an open cache file and its memory mapping.
+//
+// The file lock is a readers/writer lock that works across threads and
+// processes. flock() alone is not enough: its locks belong to the file
+// descriptor, which all threads share, so a second thread would just
+// "re-acquire" (or worse, release) the first one's lock. Threads are ordered
+// by `readers_`/`writer_` first, and only then take the flock().
+class CacheMapping
+{
+  public:
+    CacheMapping(int fd, char* base, std::size_t size)
+        : fd_(fd),
+          base_(base),
+          size_(size),
+          lock_mutex_(),
+          lock_cv_(),
+          readers_(0),
+          writer_(false) {}
+
+    ~CacheMapping()
+    {
+        ::munmap(base_, size_);
+        ::close(fd_);
+    }
+
+    CacheMapping(CacheMapping const&) = delete;
+    CacheMapping& operator=(CacheMapping const&) = delete;
+
+    std::size_t size() const { return size_; }
+
+    void LockShared()
+    {
+        std::unique_lock<std::mutex> lock(lock_mutex_);
+        lock_cv_.wait(lock, [this] { return !writer_; });
+        if (readers_++ == 0)
+        {
+            lock_file(fd_, LOCK_SH);
+        }
+    }
+
+    void UnlockShared()
+    {
+        std::lock_guard<std::mutex> lock(lock_mutex_);
+        if (--readers_ == 0)
+        {
+            ::flock(fd_, LOCK_UN);
+            lock_cv_.notify_all();
+        }
+    }
+
+    void Lock()
+    {
+        std::unique_lock<std::mutex> lock(lock_mutex_);
+        lock_cv_.wait(lock, [this] { return !writer_ && readers_ == 0; });
+        writer_ = true;
+        lock.unlock();
+        lock_file(fd_, LOCK_EX);
+    }
+
+    void Unlock()
+    {
+        ::flock(fd_, LOCK_UN);
+        std::lock_guard<std::mutex> lock(lock_mutex_);
+        writer_ = false;
+        lock_cv_.notify_all();
+    }
+
+    FileHeader ReadHeader() const
+    {
+        FileHeader header;
+        std::memcpy(&header, base_, sizeof(header));
+        return header;
+    }
+
+    void WriteHeader(FileHeader const& header)
+    {
+        std::memcpy(base_, &header, sizeof(header));
+    }
+
+    RecordHeader ReadRecord(std::size_t offset) const
+    {
+        RecordHeader record;
+        std::memcpy(&record, base_ + offset, sizeof(record));
+        return record;
+    }
+
+    char const* Key(std::size_t offset) const
+    {
+        return base_ + offset + sizeof(RecordHeader);
+    }
+
+    char const* Value(std::size_t offset) const
+    {
+        return Key(offset) + ReadRecord(offset).key_size;
+    }
+
+    void Append(std::size_t offset, std::uint64_t hash, char const* key, std::size_t key_size, char const* value, std::size_t value_size)
+    {
+        RecordHeader const record{hash, static_cast<std::uint32_t>(key_size), static_cast<std::uint32_t>(value_size)};
+        std::memcpy(base_ + offset, &record, sizeof(record));
+        std::memcpy(base_ + offset + sizeof(record), key, key_size);
+        std::memcpy(base_ + offset + sizeof(record) + key_size, value, value_size);
+    }
+
+  private:
+    int const fd_;
+    char* const base_;
+    std::size_t const size_;
+    std::mutex lock_mutex_;
+    std::condition_variable lock_cv_;
+    std::size_t readers_;
+    bool writer_;
+};
+
+namespace {
+
+// Holds a mapping's file lock (shared or exclusive) for the lifetime of the
+// object
+class MappingLock
+{
+  public:
+    MappingLock(CacheMapping& mapping, bool exclusive)
+        : mapping_(mapping),
+          exclusive_(exclusive)
+    {
+        if (exclusive_)
+        {
+            mapping_.Lock();
+        }
+        else
+        {
+            mapping_.LockShared();
+        }
+    }
+    ~MappingLock()
+    {
+        if (exclusive_)
+        {
+            mapping_.Unlock();
+        }
+        else
+        {
+            mapping_.UnlockShared();
+        }
+    }
+    MappingLock(MappingLock const&) = delete;
+    MappingLock& operator=(MappingLock const&) = delete;
+
+  private:
+    CacheMapping& mapping_;
+    bool const exclusive_;
+};
+
+// Reads the record at `offset`, returning false if it does not fit before
+// `end` (which can only happen if the file was corrupted)
+bool read_record(CacheMapping const& mapping, std::size_t offset, std::size_t end, RecordHeader& record)
+{
+    if (offset + sizeof(RecordHeader) > end)
+    {
+        return false;
+    }
+    record = mapping.ReadRecord(offset);
+    return offset + record_size(record.key_size, record.value_size) <= end;
+}
+
+// Maps `fd` and hands it over to the returned mapping. On failure `fd` is
+// left to its owner, which may still hold a lock on it.
+std::shared_ptr<CacheMapping> map_file(FileDescriptor& fd, std::string const& path, std::size_t size)
+{
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (base == MAP_FAILED) // NOLINT
+    {
+        throw system_error("failed to map cache file", path);
+    }
+    auto mapping = std::make_shared<CacheMapping>(fd.get(), static_cast<char*>(base), size);
+    fd.release();
+    return mapping;
+}
+
+// Writes a complete cache file next to `options.path` and atomically moves it
+// into place. `records` are copied over from `source` in order.
+void replace_file(CacheOptions const& options,
+                  std::uint64_t build_id,
+                  CacheMapping const* source,
+                  std::vector<std::size_t> const& records)
+{
+    std::string const tmp = options.path + ".tmp." + std::to_string(::getpid());
+    FileDescriptor fd(::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)); // NOLINT
+    if (fd.get() < 0)
+    {
+        throw system_error("failed to create cache file", tmp);
+    }
+    if (::ftruncate(fd.get(), static_cast<off_t>(options.max_bytes)) != 0)
+    {
+        auto error = system_error("failed to size cache file", tmp);
+        ::unlink(tmp.c_str());
+        throw error;
+    }
+    auto mapping = map_file(fd, tmp, options.max_bytes);
+    std::size_t end = kFirstRecord;
+    for (std::size_t offset : records)
+    {
+        RecordHeader const record = source->ReadRecord(offset);
+        mapping->Append(end, record.hash, source->Key(offset), record.key_size, source->Value(offset), record.value_size);
+        end += record_size(record.key_size, record.value_size);
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.build_id = build_id;
+    header.end = end;
+    mapping->WriteHeader(header);
+    if (::rename(tmp.c_str(), options.path.c_str()) != 0)
+    {
+        auto error = system_error("failed to replace cache file", options.path);
+        ::unlink(tmp.c_str());
+        throw error;
+    }
+}
+
+// Opens (creating or replacing if needed) the cache file and returns its
+// mapping along with the current end offset
+std::shared_ptr<CacheMapping> open_file(CacheOptions const& options, std::uint64_t build_id, std::size_t& end)
+{
+    for (;;)
+    {
+        // declared before the lock so that the descriptor is only closed
+        // once it has been unlocked
+        FileDescriptor fd(::open(options.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)); // NOLINT
+        if (fd.get() < 0)
+        {
+            throw system_error("failed to open cache file", options.path);
+        }
+        std::shared_ptr<CacheMapping> mapping = nullptr;
+        {
+            FileLock lock(fd.get());
+            struct stat st;
+            if (::fstat(fd.get(), &st) != 0)
+            {
+                throw system_error("failed to stat cache file", options.path);
+            }
+            auto const size = static_cast<std::size_t>(st.st_size);
+            if (size == 0)
+            {
+                // brand new file: nobody else can have it mapped yet, so it is
+                // safe to initialize in place
+                if (::ftruncate(fd.get(), static_cast<off_t>(options.max_bytes)) != 0)
+                {
+                    throw system_error("failed to size cache file", options.path);
+                }
+                mapping = map_file(fd, options.path, options.max_bytes);
+                FileHeader header{};
+                std::memcpy(header.magic, kMagic, sizeof(kMagic));
+                header.build_id = build_id;
+                header.end = kFirstRecord;
+                mapping->WriteHeader(header);
+                end = kFirstRecord;
+                return mapping;
+            }
+            if (size < sizeof(FileHeader))
+            {
+                throw std::runtime_error("not a cache file '" + options.path + "'");
+            }
+            mapping = map_file(fd, options.path, size);
+            FileHeader header = mapping->ReadHeader();
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+            {
+                throw std::runtime_error("not a cache file '" + options.path + "'");
+            }
+            if (header.stale != 0)
+            {
+                // replaced by another process since we opened it, try again
+                continue;
+            }
+            if (header.build_id == build_id && size == options.max_bytes && header.end >= kFirstRecord && header.end <= size)
+            {
+                end = header.end;
+                return mapping;
+            }
+            // Written by another build or with another size limit. Other
+            // processes may still have it mapped, so rather than truncating it
+            // in place, swap in a fresh file and flag this one as stale.
+            replace_file(options, build_id, nullptr, {});
+            header.stale = 1;
+            mapping->WriteHeader(header);
+        }
+    }
+}
+
+} // namespace
+
+std::shared_ptr<ResultCache> ResultCache::Open(CacheOptions const& options)
+{
+    // Caches are only shared when every option matches: a cache opened with
+    // another build id or size limit must not silently use the first one's
+    using Key = std::tuple<std::string, std::string, std::size_t, std::size_t>;
+    static std::mutex registry_mutex;
+    static std::map<Key, std::weak_ptr<ResultCache>> registry;
+
+    Key const key{options.path, options.build_id, options.max_bytes, options.compact_bytes};
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    auto it = registry.find(key);
+    if (it != registry.end())
+    {
+        std::shared_ptr<ResultCache> cache = it->second.lock();
+        if (cache)
+        {
+            return cache;
+        }
+    }
+    // Drop every cache nobody uses anymore (including this one) so that the
+    // registry does not keep an entry for each set of options ever opened
+    for (it = registry.begin(); it != registry.end();)
+    {
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+    }
+    auto cache = std::make_shared<ResultCache>(options);
+    registry.emplace(key, cache);
+    return cache;
+}
+
+ResultCache::ResultCache(CacheOptions options)
+    : options_(std::move(options)),
+      build_id_(fnv1a(options_.build_id.data(), options_.build_id.size())),
+      mutex_(),
+      mapping_(nullptr),
+      index_(),
+      indexed_end_(kFirstRecord)
+{
+    if (options_.max_bytes <= kFirstRecord)
+    {
+        throw std::runtime_error("cache size limit is too small");
+    }
+    if (options_.compact_bytes > options_.max_bytes)
+    {
+        throw std::runtime_error("cache compaction size is larger than its size limit");
+    }
+}
+
+bool ResultCache::Get(std::string const& key, CachedValue& value)
+{
+    for (;;)
+    {
+        std::shared_ptr<CacheMapping> mapping = Current();
+        bool stale = false;
+        {
+            // a shared lock keeps writers from moving the header while we
+            // read it, without serializing readers
+            MappingLock lock(*mapping, false);
+            FileHeader const header = mapping->ReadHeader();
+            stale = header.stale != 0;
+            if (!stale)
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                if (mapping_ != mapping)
+                {
+                    // another thread already reopened the file
+                    continue;
+                }
+                // pick up records appended by other processes
+                IndexTo(header.end);
+                std::size_t offset = 0;
+                if (!Find(key, offset))
+                {
+                    return false;
+                }
+                value.mapping = mapping;
+                value.data = mapping->Value(offset);
+                value.size = mapping->ReadRecord(offset).value_size;
+                return true;
+            }
+        }
+        Reopen(mapping);
+    }
+}
+
+void ResultCache::Put(std::string const& key, std::vector<char> const& value)
+{
+    std::size_t const size = record_size(key.size(), value.size());
+    if (size > options_.max_bytes - kFirstRecord)
+    {
+        return;
+    }
+    std::uint64_t const hash = fnv1a(key.data(), key.size());
+
+    for (;;)
+    {
+        std::shared_ptr<CacheMapping> mapping = Current();
+        bool stale = false;
+        {
+            MappingLock lock(*mapping, true);
+            FileHeader header = mapping->ReadHeader();
+            stale = header.stale != 0;
+            if (!stale)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex_);
+                    if (mapping_ != mapping)
+                    {
+                        continue;
+                    }
+                    IndexTo(header.end);
+                    std::size_t offset = 0;
+                    if (Find(key, offset))
+                    {
+                        return;
+                    }
+                }
+                if (header.end + size <= mapping->size())
+                {
+                    // the index catches up on the next Get() or Put()
+                    mapping->Append(header.end, hash, key.data(), key.size(), value.data(), value.size());
+                    header.end += size;
+                    mapping->WriteHeader(header);
+                    return;
+                }
+                // Compacting writes a whole new file. Only the file lock is
+                // held while doing so, so Get() can keep using the index.
+                Compact(*mapping, header.end, size);
+                stale = true;
+            }
+        }
+        Reopen(mapping);
+    }
+}
+
+// Returns the current mapping, opening the file on first use
+std::shared_ptr<CacheMapping> ResultCache::Current()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (mapping_)
+        {
+            return mapping_;
+        }
+    }
+    Reopen(nullptr);
+    std::lock_guard<std::mutex> guard(mutex_);
+    return mapping_;
+}
+
+// Replaces `stale` (nullptr on first use) with a freshly opened mapping. The
+// file is opened without holding mutex_: if another thread swapped in a new
+// mapping meanwhile, that one is kept and ours is dropped.
+void ResultCache::Reopen(std::shared_ptr<CacheMapping> const& stale)
+{
+    std::size_t end = kFirstRecord;
+    std::shared_ptr<CacheMapping> mapping = open_file(options_, build_id_, end);
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (mapping_ == stale)
+    {
+        mapping_ = std::move(mapping);
+        index_.clear();
+        indexed_end_ = kFirstRecord;
+        IndexTo(end);
+    }
+}
+
+// Must be called with mutex_ held. Adds every record between the last indexed
+// offset and `end` to the index. Committed records never change, so this does
+// not need the file lock.
+void ResultCache::IndexTo(std::size_t end)
+{
+    end = std::min(end, mapping_->size());
+    RecordHeader record;
+    while (indexed_end_ < end && read_record(*mapping_, indexed_end_, end, record))
+    {
+        index_.emplace(record.hash, indexed_end_);
+        indexed_end_ += record_size(record.key_size, record.value_size);
+    }
+}
+
+// Must be called with mutex_ held
+bool ResultCache::Find(std::string const& key, std::size_t& offset) const
+{
+    auto range = index_.equal_range(fnv1a(key.data(), key.size()));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        RecordHeader const record = mapping_->ReadRecord(it->second);
+        if (record.key_size == key.size() && std::memcmp(mapping_->Key(it->second), key.data(), key.size()) == 0)
+        {
+            offset = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Must be called with `mapping`'s exclusive file lock held. Keeps the newest
+// records before `end` that fit within compact_bytes (leaving room for a
+// record of `reserve` bytes), writes them to a fresh file and flags the
+// current one as stale.
+void ResultCache::Compact(CacheMapping& mapping, std::size_t end, std::size_t reserve) const
+{
+    std::size_t const target = options_.compact_bytes == 0 ? options_.max_bytes / 2 : options_.compact_bytes;
+    std::size_t const limit = std::min(target, options_.max_bytes - reserve);
+    // a target smaller than the header keeps no records at all
+    std::size_t const budget = limit > kFirstRecord ? limit - kFirstRecord : 0;
+
+    end = std::min(end, mapping.size());
+    std::vector<std::size_t> records;
+    RecordHeader record;
+    for (std::size_t offset = kFirstRecord; offset < end && read_record(mapping, offset, end, record);)
+    {
+        records.push_back(offset);
+        offset += record_size(record.key_size, record.value_size);
+    }
+
+    std::vector<std::size_t> keep;
+    std::unordered_set<std::string> seen;
+    std::size_t used = 0;
+    for (auto it = records.rbegin(); it != records.rend(); ++it)
+    {
+        record = mapping.ReadRecord(*it);
+        std::size_t const size = record_size(record.key_size, record.value_size);
+        if (used + size > budget)
+        {
+            break;
+        }
+        if (seen.emplace(mapping.Key(*it), record.key_size).second)
+        {
+            keep.push_back(*it);
+            used += size;
+        }
+    }
+    std::reverse(keep.begin(), keep.end());
+
+    replace_file(options_, build_id_, &mapping, keep);
+    FileHeader header = mapping.ReadHeader();
+    header.stale = 1;
+    mapping.WriteHeader(header);
+}
+
+} // namespace object_async
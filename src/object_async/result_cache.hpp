@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace object_async {
+
+// Default build id used to version the cache file. Results cached by one
+// build of the module are discarded when a different build opens the file.
+// binding.gyp sets it to the package version, so rebuilding the same release
+// keeps the cache valid.
+#ifndef RESULT_CACHE_BUILD_ID
+#error "RESULT_CACHE_BUILD_ID must be defined (binding.gyp sets it to the package version)"
+#endif
+
+struct CacheOptions
+{
+    // location of the cache file
+    std::string path = "";
+    // results cached under a different build id are ignored
+    std::string build_id = RESULT_CACHE_BUILD_ID;
+    // hard limit for the size of the cache file
+    std::size_t max_bytes = 64 * 1024 * 1024;
+    // size the cache is compacted down to once it is full, at most max_bytes
+    // (0 means max_bytes / 2)
+    std::size_t compact_bytes = 0;
+};
+
+class CacheMapping;
+
+// A cached value that points directly into the memory mapped cache file.
+// Holding on to `mapping` keeps the memory behind `data` valid, even after the
+// cache has been compacted into a new file. The mapping is shared with other
+// processes, so the value must be treated as read-only and copied before it is
+// handed out to anything that may write to it.
+struct CachedValue
+{
+    std::shared_ptr<CacheMapping> mapping = nullptr;
+    char const* data = nullptr;
+    std::size_t size = 0;
+};
+
+/**
+ * ResultCache is a persistent, append-only, memory mapped key/value store used
+ * to skip expensive work across process restarts.
+ *
+ * - The file starts with a header (magic, build id hash, end offset) followed
+ *   by records appended back to back. A record only becomes visible once the
+ *   header's end offset has been bumped past it, so a crash mid-write simply
+ *   loses that record.
+ * - The file is opened lazily by the first Get() or Put(), which run on the
+ *   threadpool, so creating a cache never blocks the Javascript thread.
+ * - An in-memory hash index maps keys to records. Get() takes a shared file
+ *   lock and re-reads the header every time, so it sees records appended by
+ *   other processes and notices when the file has been replaced.
+ * - Put() appends under an exclusive file lock. The file lock orders both
+ *   threads and processes; `mutex_` only guards the index and is never held
+ *   while waiting for the file lock.
+ * - When an append would exceed `max_bytes`, the newest records that fit in
+ *   `compact_bytes` are copied into a fresh file which atomically replaces the
+ *   old one. The old file is flagged as stale so that other processes reopen;
+ *   it stays mapped until the last CachedValue pointing into it is released.
+ *
+ * All methods are safe to call from worker threads.
+ */
+class ResultCache
+{
+  public:
+    // Returns the cache for `options`, shared by every caller in the process
+    // that passes the same options. Throws std::runtime_error if the options
+    // are invalid.
+    static std::shared_ptr<ResultCache> Open(CacheOptions const& options);
+
+    explicit ResultCache(CacheOptions options);
+
+    // Returns true and points `value` at the cached bytes if `key` is cached.
+    // Throws std::runtime_error if the file cannot be opened.
+    bool Get(std::string const& key, CachedValue& value);
+
+    // Appends `value` under `key`, compacting the file first if it is full.
+    // Values that can never fit in the cache are silently dropped.
+    void Put(std::string const& key, std::vector<char> const& value);
+
+  private:
+    std::shared_ptr<CacheMapping> Current();
+    void Reopen(std::shared_ptr<CacheMapping> const& stale);
+    void IndexTo(std::size_t end);
+    bool Find(std::string const& key, std::size_t& offset) const;
+    void Compact(CacheMapping& mapping, std::size_t end, std::size_t reserve) const;
+
+    CacheOptions const options_;
+    std::uint64_t const build_id_;
+    // guards mapping_ and the index
+    std::mutex mutex_;
+    std::shared_ptr<CacheMapping> mapping_;
+    std::unordered_multimap<std::uint64_t, std::size_t> index_;
+    std::size_t indexed_end_;
+};
+
+} // namespace object_async
@@ -1,5 +1,8 @@
 #include "hello.hpp"
+#include "../module_utils.hpp"
+
 #include <memory>
+#include <string>
 
 // If this was not defined within a namespace, it would be in the global scope.
 // Namespaces are used because C++ has no notion of scoped modules, so all of
@@ -8,8 +11,6 @@
 // clearly organize your application.
 namespace object_sync {
 
-Napi::FunctionReference HelloObject::constructor; // NOLINT
-
 // Triggered from Javascript world when calling "new HelloObject(name)"
 HelloObject::HelloObject(Napi::CallbackInfo const& info)
     : Napi::ObjectWrap<HelloObject>(info)
@@ -37,20 +38,74 @@ Napi::Value HelloObject::hello(Napi::CallbackInfo const& info)
     return Napi::String::New(env, name_);
 }
 
-Napi::Object HelloObject::Init(Napi::Env env, Napi::Object exports)
+// Synchronous bulk variant of hello: accepts either a count or an array of
+// options objects ({ louder: boolean }) and returns every result packed into
+// a single buffer plus an offsets table, so Javascript pays for one call
+// instead of one per item.
+Napi::Value HelloObject::helloMany(Napi::CallbackInfo const& info)
 {
+    Napi::Env env = info.Env();
+    std::string const louder_name = name_ + "!!!!";
+    utils::PackedResults results;
+    bool ok = true;
 
-    Napi::Function func = DefineClass(env, "HelloObject", {InstanceMethod("helloMethod", &HelloObject::hello)});
-    // Create a peristent reference to the class constructor. This will allow
-    // a function called on a class prototype and a function
-    // called on instance of a class to be distinguished from each other.
-    constructor = Napi::Persistent(func);
-    // Call the SuppressDestruct() method on the static data prevent the calling
-    // to this destructor to reset the reference when the environment is no longer
-    // available.
-    constructor.SuppressDestruct();
-    exports.Set("HelloObject", func);
-    return exports;
+    if (info[0].IsArray())
+    {
+        Napi::Array items = info[0].As<Napi::Array>();
+        std::uint32_t const length = items.Length();
+        ok = results.Reserve(length, louder_name.size());
+        for (std::uint32_t i = 0; i < length && ok; ++i)
+        {
+            Napi::Value item = items.Get(i);
+            if (!item.IsObject())
+            {
+                Napi::TypeError::New(env, "each item must be an options object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            bool louder = false;
+            Napi::Object options = item.As<Napi::Object>();
+            if (options.Has(Napi::String::New(env, "louder")))
+            {
+                Napi::Value louder_val = options.Get(Napi::String::New(env, "louder"));
+                if (!louder_val.IsBoolean())
+                {
+                    Napi::TypeError::New(env, "option 'louder' must be a boolean").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                louder = louder_val.As<Napi::Boolean>().Value();
+            }
+            ok = results.Append(louder ? louder_name : name_);
+        }
+    }
+    else
+    {
+        std::size_t count = 0;
+        if (!utils::GetCount(env, info[0], count))
+        {
+            return env.Null();
+        }
+        ok = results.Reserve(count, name_.size());
+        for (std::size_t i = 0; i < count && ok; ++i)
+        {
+            ok = results.Append(name_);
+        }
+    }
+
+    if (!ok)
+    {
+        Napi::RangeError::New(env, "results would exceed the 4GB limit").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    return results.Finish(env);
+}
+
+// Defines the class for `env`. It is called once per environment, the first
+// time the class is accessed (see module.cpp), which also keeps a persistent
+// reference to the constructor for as long as the environment lives.
+Napi::Function HelloObject::Define(Napi::Env env)
+{
+    return DefineClass(env, "HelloObject", {InstanceMethod("helloMethod", &HelloObject::hello),
+                                            InstanceMethod("helloMany", &HelloObject::helloMany)});
 }
 
 } // namespace object_sync
@@ -13,12 +13,12 @@ class HelloObject : public Napi::ObjectWrap<HelloObject>
 {
   public:
     // initializers
-    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::Function Define(Napi::Env env);
     explicit HelloObject(Napi::CallbackInfo const& info);
     Napi::Value hello(Napi::CallbackInfo const& info);
+    Napi::Value helloMany(Napi::CallbackInfo const& info);
 
   private:
-    static Napi::FunctionReference constructor;
     std::string name_ = "";
 };
 } // namespace object_sync
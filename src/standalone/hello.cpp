@@ -1,4 +1,7 @@
 #include "hello.hpp"
+#include "../module_utils.hpp"
+
+#include <string>
 
 namespace standalone {
 
@@ -8,4 +11,30 @@ Napi::Value hello(Napi::CallbackInfo const& info)
     return Napi::String::New(env, "hello world");
 }
 
+// For small payloads the cost of crossing from Javascript into C++ dominates,
+// so helloMany produces all of its results in one call and returns them
+// packed into a single buffer (see utils::PackedResults)
+Napi::Value helloMany(Napi::CallbackInfo const& info)
+{
+    Napi::Env env = info.Env();
+    std::size_t count = 0;
+    if (!utils::GetCount(env, info[0], count))
+    {
+        return env.Null();
+    }
+
+    std::string const item = "hello world";
+    utils::PackedResults results;
+    if (!results.Reserve(count, item.size()))
+    {
+        Napi::RangeError::New(env, "results would exceed the 4GB limit").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        results.Append(item);
+    }
+    return results.Finish(env);
+}
+
 } // namespace standalone
@@ -6,4 +6,8 @@ namespace standalone {
 // hello, custom sync method
 Napi::Value hello(Napi::CallbackInfo const& info);
 
+// helloMany, sync bulk variant of hello
+// returns `count` results packed into a single buffer
+Napi::Value helloMany(Napi::CallbackInfo const& info);
+
 } // namespace standalone
@@ -1,4 +1,5 @@
 #include "hello_async.hpp"
+#include "../batching/batched_worker.hpp"
 #include "../cpu_intensive_task.hpp"
 #include "../module_utils.hpp"
 
@@ -14,11 +15,13 @@ namespace standalone_async {
 // callback when done.
 // Consider storing all C++ objects you need by value or by shared_ptr to keep
 // them alive until done.
+// batching::BatchedWorker mirrors the Napi::AsyncWorker interface, but
+// delivers completions in batches (see src/batching/batched_worker.hpp).
 // Napi::AsyncWorker docs:
 // https://github.com/nodejs/node-addon-api/blob/master/doc/async_worker.md
-struct AsyncHelloWorker : Napi::AsyncWorker
+struct AsyncHelloWorker : batching::BatchedWorker
 {
-    using Base = Napi::AsyncWorker;
+    using Base = batching::BatchedWorker;
     // ctor
     AsyncHelloWorker(bool louder, bool buffer, Napi::Function const& cb)
         : Base(cb),
@@ -128,10 +131,10 @@ Napi::Value helloAsync(Napi::CallbackInfo const& info)
 
     // Creates a worker instance and queues it to run asynchronously, invoking the
     // callback when done.
-    // - Napi::AsyncWorker takes a pointer to a Napi::FunctionReference and deletes the
-    // pointer automatically.
-    // - Napi::AsyncQueueWorker takes a pointer to a Napi::AsyncWorker and deletes
-    // the pointer automatically.
+    // - batching::BatchedWorker keeps a persistent reference to the callback
+    // until it is called.
+    // - Once queued, the worker is deleted automatically after its completion
+    // has been delivered.
     auto* worker = new AsyncHelloWorker{louder, buffer, callback}; // NOLINT
     worker->Queue();
     return env.Undefined(); // NOLINT
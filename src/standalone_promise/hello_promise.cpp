@@ -1,4 +1,5 @@
 #include "hello_promise.hpp"
+#include "../batching/batched_worker.hpp"
 
 #include <iostream>
 #include <utility>
@@ -6,11 +7,13 @@
 namespace standalone_promise {
 
 // async worker that handles the Deferred methods
-struct PromiseWorker : Napi::AsyncWorker
+// Promises are resolved in batches along with other completions, see
+// src/batching/batched_worker.hpp
+struct PromiseWorker : batching::BatchedWorker
 {
     // constructor / ctor
     PromiseWorker(Napi::Env const& env, std::string phrase, int multiply)
-        : Napi::AsyncWorker(env),
+        : batching::BatchedWorker(env),
           phrase_(std::move(phrase)),
           multiply_(multiply),
           deferred_(Napi::Promise::Deferred::New(env)) {}
@@ -106,14 +109,13 @@ Napi::Value helloPromise(Napi::CallbackInfo const& info)
         }
     }
 
-    // initialize Napi::AsyncWorker
+    // initialize batching::BatchedWorker
     // This comes with a GetPromise that returns the necessary
     // Napi::Promise::Deferred class that we send the user
     auto* worker = new PromiseWorker{env, phrase, multiply};
     auto promise = worker->GetPromise();
 
     // begin asynchronous work by queueing it.
-    // https://github.com/nodejs/node-addon-api/blob/main/doc/async_worker.md#queue
     worker->Queue();
 
     // return the deferred promise to the user. Let the
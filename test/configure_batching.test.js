@@ -0,0 +1,133 @@
+var test = require('tape');
+var module = require('../lib/index.js');
+
+test('returns default settings', function(t) {
+  var settings = module.configureBatching();
+  t.equal(settings.enabled, true, 'batching enabled by default');
+  t.equal(settings.maxBatchSize, 256, 'default maxBatchSize');
+  t.equal(settings.maxLatency, 0, 'default maxLatency');
+  t.end();
+});
+
+test('success: delivers every completion exactly once with small batches', function(t) {
+  var settings = module.configureBatching({ maxBatchSize: 2, maxLatency: 5 });
+  t.equal(settings.maxBatchSize, 2, 'set maxBatchSize');
+  t.equal(settings.maxLatency, 5, 'set maxLatency');
+  // Workers finish in whatever order the threadpool runs them, so only count
+  // deliveries here: each promise must resolve once, with its own result
+  var delivered = [];
+  var promises = [];
+  [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20].forEach(function(i) {
+    promises.push(module.helloPromise({ phrase: 'a', multiply: i }).then(function(result) {
+      t.equal(result.length, i, 'expected result for ' + i);
+      delivered.push(i);
+    }));
+  });
+  Promise.all(promises).then(function() {
+    t.equal(delivered.length, 20, 'every completion delivered');
+    t.deepEqual(delivered.slice().sort(function(a, b) { return a - b; }), [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20], 'each exactly once');
+    module.configureBatching({ maxBatchSize: 256, maxLatency: 0 });
+    t.end();
+  });
+});
+
+test('success: callbacks and promises are delivered in the same batch', function(t) {
+  // a batch of two is only delivered once both have completed
+  module.configureBatching({ maxBatchSize: 2, maxLatency: 10000 });
+  var events = [];
+  var check = function() {
+    if (events.length < 3) return;
+    t.deepEqual(events.slice(0, 2).sort(), ['callback', 'promise'], 'both delivered');
+    t.equal(events[2], 'immediate', 'in the same loop turn');
+    module.configureBatching({ maxBatchSize: 256, maxLatency: 0 });
+    t.end();
+  };
+  var delivered = function(name) {
+    if (events.length === 0) {
+      // queued by the first completion: it can only run before the second one
+      // if they were delivered separately
+      setImmediate(function() {
+        events.push('immediate');
+        check();
+      });
+    }
+    events.push(name);
+    check();
+  };
+  module.helloAsync({ louder: false }, function(err, result) {
+    if (err) throw err;
+    t.equal(result, '...threads are busy async bees...hello world');
+    delivered('callback');
+  });
+  module.helloPromise().then(function(result) {
+    t.equal(result, 'hello');
+    delivered('promise');
+  });
+});
+
+test('success: completions are still delivered with batching disabled', function(t) {
+  t.equal(module.configureBatching({ enabled: false }).enabled, false, 'set enabled');
+  var remaining = 3;
+  var done = function() {
+    if (--remaining === 0) {
+      module.configureBatching({ enabled: true });
+      t.end();
+    }
+  };
+  module.helloAsync({ louder: false }, function(err, result) {
+    if (err) throw err;
+    t.equal(result, '...threads are busy async bees...hello world');
+    done();
+  });
+  module.helloPromise({ phrase: 'hi', multiply: 2 }).then(function(result) {
+    t.equal(result, 'hihi');
+    done();
+  });
+  new module.HelloObjectAsync('carol').helloAsync({ louder: true }, function(err, result) {
+    if (err) throw err;
+    t.equal(result, '...threads are busy async bees...hello carol!!!!');
+    done();
+  });
+});
+
+var AsyncLocalStorage = require('async_hooks').AsyncLocalStorage;
+require('v8').setFlagsFromString('--expose-gc');
+var gc = require('vm').runInNewContext('gc');
+
+test('success: callbacks run in the async context they were created in', { skip: !AsyncLocalStorage }, function(t) {
+  module.configureBatching({ maxBatchSize: 256, maxLatency: 5 });
+  var storage = new AsyncLocalStorage();
+  var remaining = 16;
+  var done = function() {
+    if (--remaining === 0) {
+      module.configureBatching({ maxBatchSize: 256, maxLatency: 0 });
+      t.end();
+    }
+  };
+  for (var i = 0; i < 8; i++) {
+    // every call completes in the same batch, but must see its own store
+    storage.run(i, function() {
+      var expected = storage.getStore();
+      module.helloAsync({ louder: false }, function(err, result) {
+        if (err) throw err;
+        t.equal(storage.getStore(), expected, 'callback ' + expected + ' sees its own store');
+        done();
+      });
+      module.helloPromise().then(function() {
+        t.equal(storage.getStore(), expected, 'promise ' + expected + ' sees its own store');
+        done();
+      });
+    });
+  }
+  // the async contexts must still work after a garbage collection
+  setImmediate(gc);
+});
+
+test('error: throws on invalid options', function(t) {
+  t.throws(function() { module.configureBatching('oops'); }, /options must be an object/);
+  t.throws(function() { module.configureBatching({ enabled: 'no' }); }, /option 'enabled' must be a boolean/);
+  t.throws(function() { module.configureBatching({ maxBatchSize: 0 }); }, /option 'maxBatchSize' must be 1 or greater/);
+  t.throws(function() { module.configureBatching({ maxLatency: -1 }); }, /option 'maxLatency' must be 0 or greater/);
+  t.throws(function() { module.configureBatching({ maxLatency: 'soon' }); }, /option 'maxLatency' must be 0 or greater/);
+  t.end();
+});
@@ -0,0 +1,88 @@
+var test = require('tape');
+var child_process = require('child_process');
+var path = require('path');
+var module = require('../lib/index.js');
+var binding = require('../lib/binding/module.node');
+
+var names = ['hello', 'helloMany', 'helloAsync', 'helloPromise', 'configureBatching', 'HelloObject', 'HelloObjectAsync'];
+
+// Other tests in this process may already have touched the exports, so
+// anything about their initial state is checked in a fresh process
+function fresh(body) {
+  var script = '"use strict";\n' +
+    'var m = require(' + JSON.stringify(path.join(__dirname, '..', 'lib', 'index.js')) + ');\n' +
+    'var names = ' + JSON.stringify(names) + ';\n' +
+    'var describe = function(name) {\n' +
+    '  var d = Object.getOwnPropertyDescriptor(m, name);\n' +
+    '  return { getter: typeof d.get === "function", value: typeof d.value, writable: !!d.writable, enumerable: d.enumerable, configurable: d.configurable };\n' +
+    '};\n' +
+    'var result = (function() {\n' + body + '\n})();\n' +
+    'process.stdout.write(JSON.stringify(result));';
+  return JSON.parse(child_process.execFileSync(process.execPath, ['-e', script], { encoding: 'utf8' }));
+}
+
+test('exports start out as lazy, enumerable and configurable accessors', function(t) {
+  var result = fresh('return { keys: Object.keys(m), before: names.map(describe) };');
+  names.forEach(function(name, i) {
+    t.ok(result.keys.indexOf(name) > -1, name + ' is enumerable');
+    t.ok(result.before[i].getter, name + ' is defined as a getter');
+    t.ok(result.before[i].configurable, name + ' is configurable');
+  });
+  t.end();
+});
+
+test('exports become plain data properties once accessed', function(t) {
+  var result = fresh('names.forEach(function(name) { return m[name]; }); return names.map(describe);');
+  names.forEach(function(name, i) {
+    t.notOk(result[i].getter, name + ' no longer has a getter');
+    t.equal(result[i].value, 'function', name + ' holds the function');
+    t.ok(result[i].writable && result[i].enumerable && result[i].configurable, name + ' is writable, enumerable and configurable');
+  });
+  t.end();
+});
+
+test('exports can be reassigned in strict mode, before and after first access', function(t) {
+  var result = fresh(
+    'var stub = function() { return "stub"; };\n' +
+    'm.hello = stub;\n' +
+    'var before = m.hello === stub && m.hello() === "stub";\n' +
+    'var original = m.helloMany;\n' +
+    'm.helloMany = stub;\n' +
+    'var after = m.helloMany === stub;\n' +
+    'm.helloMany = original;\n' +
+    'return { before: before, after: after, restored: m.helloMany === original && typeof original === "function" };');
+  t.ok(result.before, 'assigned before first access');
+  t.ok(result.after, 'assigned after first access');
+  t.ok(result.restored, 'restored to the original');
+  t.end();
+});
+
+test('exports can be read after being frozen, before and after first access', function(t) {
+  var result = fresh(
+    'var first = m.helloMany;\n' +
+    'Object.freeze(m);\n' +
+    'var hello = m.hello;\n' +
+    'return {\n' +
+    '  hello: typeof hello === "function" && hello() === "hello world",\n' +
+    '  cached: m.hello === hello && m.helloMany === first,\n' +
+    '  all: names.every(function(name) { return typeof m[name] === "function"; }),\n' +
+    '  primitive: typeof Reflect.get(m, "helloAsync", 1) === "function",\n' +
+    '  frozen: Object.isFrozen(m)\n' +
+    '};');
+  t.ok(result.hello, 'read after freezing');
+  t.ok(result.cached, 'every read returns the same function');
+  t.ok(result.all, 'every export can be read');
+  t.ok(result.primitive, 'read with a primitive receiver');
+  t.ok(result.frozen, 'exports stay frozen');
+  t.end();
+});
+
+test('exports are built once and cached', function(t) {
+  names.forEach(function(name) {
+    t.equal(typeof module[name], 'function', name + ' is a function');
+    t.equal(module[name], module[name], name + ' returns the same function every time');
+    t.equal(module[name], binding[name], name + ' matches the binding');
+  });
+  t.ok(new module.HelloObject('carol') instanceof binding.HelloObject, 'instances match the cached class');
+  t.end();
+});
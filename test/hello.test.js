@@ -7,3 +7,29 @@ test('prints world', function(t) {
   t.end();
 });
 
+
+test('helloMany: packs results into a single buffer', function(t) {
+  var result = module.helloMany(3);
+  t.ok(Buffer.isBuffer(result.data), 'data is a buffer');
+  t.ok(result.offsets instanceof Uint32Array, 'offsets is a Uint32Array');
+  t.equal(result.offsets.length, 4, 'one offset per item plus one');
+  for (var i = 0; i < 3; i++) {
+    t.equal(result.data.toString('utf8', result.offsets[i], result.offsets[i + 1]), 'hello world');
+  }
+  t.end();
+});
+
+test('helloMany: zero count returns empty buffer', function(t) {
+  var result = module.helloMany(0);
+  t.equal(result.data.length, 0);
+  t.deepEqual(Array.from(result.offsets), [0]);
+  t.end();
+});
+
+test('helloMany: throws on invalid count', function(t) {
+  t.throws(function() { module.helloMany(-1); }, /count must be a non-negative integer/);
+  t.throws(function() { module.helloMany(1.5); }, /count must be a non-negative integer/);
+  t.throws(function() { module.helloMany('3'); }, /count must be a non-negative integer/);
+  t.throws(function() { module.helloMany(4e9); }, /results would exceed the 4GB limit/);
+  t.end();
+});
@@ -47,3 +47,36 @@ test('error: handles missing arg', function(t) {
     t.end();
   }
 });
+
+test('helloMany: count returns packed results', function(t) {
+  var H = new module.HelloObject('carol');
+  var result = H.helloMany(2);
+  t.deepEqual(Array.from(result.offsets), [0, 5, 10]);
+  t.equal(result.data.toString(), 'carolcarol');
+  t.end();
+});
+
+test('helloMany: array of options returns packed results', function(t) {
+  var H = new module.HelloObject('carol');
+  var result = H.helloMany([{}, { louder: true }, { louder: false }]);
+  t.equal(result.offsets.length, 4);
+  t.equal(result.data.toString('utf8', result.offsets[0], result.offsets[1]), 'carol');
+  t.equal(result.data.toString('utf8', result.offsets[1], result.offsets[2]), 'carol!!!!');
+  t.equal(result.data.toString('utf8', result.offsets[2], result.offsets[3]), 'carol');
+  t.end();
+});
+
+test('helloMany: error on invalid options', function(t) {
+  var H = new module.HelloObject('carol');
+  t.throws(function() { H.helloMany([{ louder: 'yes' }]); }, /option 'louder' must be a boolean/);
+  t.throws(function() { H.helloMany([null]); }, /each item must be an options object/);
+  t.throws(function() { H.helloMany({}); }, /count must be a non-negative integer/);
+  t.end();
+});
+
+test('helloMany: error when results would not fit', function(t) {
+  var H = new module.HelloObject('a');
+  t.throws(function() { H.helloMany(3e9); }, /results would exceed the 4GB limit/);
+  t.throws(function() { H.helloMany(new Array(1e9)); }, /results would exceed the 4GB limit/);
+  t.end();
+});
@@ -107,3 +107,147 @@ test('error: handles missing arg', function(t) {
     t.end();
   }
 });
+
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+function cachePath(name) {
+  var file = path.join(os.tmpdir(), 'node-cpp-skel-' + process.pid + '-' + name + '.cache');
+  if (fs.existsSync(file)) fs.unlinkSync(file);
+  return file;
+}
+
+// Rewrites every cached result in the file from 'hello ...' to 'HELLO ...',
+// so results served from the cache can be told apart from recomputed ones
+function markCached(file) {
+  var data = fs.readFileSync(file);
+  var from = Buffer.from('hello ');
+  var to = Buffer.from('HELLO ');
+  for (var i = data.indexOf(from); i !== -1; i = data.indexOf(from, i + from.length)) {
+    to.copy(data, i);
+  }
+  var fd = fs.openSync(file, 'r+');
+  fs.writeSync(fd, data, 0, data.length, 0);
+  fs.closeSync(fd);
+}
+
+test('cache: serves results from the cache file', function(t) {
+  var file = cachePath('hit');
+  var H = new module.HelloObjectAsync('carol', { cache: { path: file } });
+  H.helloAsync({ louder: true }, function(err, result) {
+    if (err) throw err;
+    t.equal(result, '...threads are busy async bees...hello carol!!!!');
+    t.ok(fs.existsSync(file), 'cache file created');
+    markCached(file);
+    // a fresh object pointed at the same file skips the expensive work
+    var H2 = new module.HelloObjectAsync('carol', { cache: { path: file } });
+    H2.helloAsync({ louder: true, buffer: true }, function(err, buffer) {
+      if (err) throw err;
+      t.ok(Buffer.isBuffer(buffer), 'returns a buffer');
+      t.equal(buffer.toString(), '...threads are busy async bees...HELLO carol!!!!', 'served from cache');
+      // writing to the buffer must not change what the cache serves next
+      buffer.fill('x');
+      H2.helloAsync({ louder: true, buffer: true }, function(err, again) {
+        if (err) throw err;
+        t.equal(again.toString(), '...threads are busy async bees...HELLO carol!!!!');
+        fs.unlinkSync(file);
+        t.end();
+      });
+    });
+  });
+});
+
+test('cache: keys include options', function(t) {
+  var file = cachePath('options');
+  var H = new module.HelloObjectAsync('carol', { cache: { path: file } });
+  H.helloAsync({ louder: true }, function(err, result) {
+    if (err) throw err;
+    markCached(file);
+    H.helloAsync({ louder: false }, function(err, result) {
+      if (err) throw err;
+      t.equal(result, '...threads are busy async bees...hello carol', 'recomputed result');
+      fs.unlinkSync(file);
+      t.end();
+    });
+  });
+});
+
+test('cache: results from another build id are ignored', function(t) {
+  var file = cachePath('build');
+  var H = new module.HelloObjectAsync('carol', { cache: { path: file, buildId: 'one' } });
+  H.helloAsync({}, function(err, result) {
+    if (err) throw err;
+    markCached(file);
+    // H is still alive, so its cache must not be handed out for build 'two'
+    var H2 = new module.HelloObjectAsync('carol', { cache: { path: file, buildId: 'two' } });
+    H2.helloAsync({}, function(err, result) {
+      if (err) throw err;
+      t.equal(result, '...threads are busy async bees...hello carol', 'recomputed result');
+      t.ok(H, 'first object stays alive');
+      fs.unlinkSync(file);
+      t.end();
+    });
+  });
+});
+
+test('cache: compacts once the size limit is reached', function(t) {
+  var file = cachePath('limit');
+  // every result takes 72 bytes in the file: 13 of them fit in 1024 bytes,
+  // and compacting keeps the newest 6 (plus the one being added)
+  var options = { cache: { path: file, maxBytes: 1024, compactBytes: 512 } };
+  var hello = function(name, callback) {
+    new module.HelloObjectAsync(name, options).helloAsync({}, function(err, result) {
+      if (err) throw err;
+      callback(result);
+    });
+  };
+
+  // results are added one at a time, so "newest" is well defined
+  var add = function(i) {
+    if (i === 20) return check();
+    hello('name' + i, function() { add(i + 1); });
+  };
+  var check = function() {
+    markCached(file);
+    var newest = ['name15', 'name16', 'name17', 'name18', 'name19'];
+    var next = function() {
+      var name = newest.shift();
+      if (!name) {
+        return hello('name0', function(result) {
+          t.equal(result, '...threads are busy async bees...hello name0', 'oldest result was dropped');
+          fs.unlinkSync(file);
+          t.end();
+        });
+      }
+      hello(name, function(result) {
+        t.equal(result, '...threads are busy async bees...HELLO ' + name, name + ' served from cache');
+        next();
+      });
+    };
+    next();
+  };
+  add(0);
+});
+
+test('error: handles invalid cache options', function(t) {
+  t.throws(function() { new module.HelloObjectAsync('carol', 'oops'); }, /second arg 'options' must be an object/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: true }); }, /option 'cache' must be an object/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: {} }); }, /option 'cache.path' must be a non-empty string/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: { path: cachePath('x'), maxBytes: -1 } }); }, /option 'cache.maxBytes' must be a positive integer/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: { path: cachePath('x'), maxBytes: 1024.5 } }); }, /option 'cache.maxBytes' must be a positive integer/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: { path: cachePath('x'), compactBytes: 1.5 } }); }, /option 'cache.compactBytes' must be a positive integer/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: { path: cachePath('x'), maxBytes: 1024, compactBytes: 2048 } }); }, /option 'cache.compactBytes' must not be larger than 'cache.maxBytes'/);
+  t.throws(function() { new module.HelloObjectAsync('carol', { cache: { path: cachePath('x'), buildId: 1 } }); }, /option 'cache.buildId' must be a string/);
+  t.end();
+});
+
+test('cache: computes results when the cache file cannot be opened', function(t) {
+  // the file is only opened on the threadpool, by the first call
+  var H = new module.HelloObjectAsync('carol', { cache: { path: path.join(os.tmpdir(), 'does-not-exist', 'x.cache') } });
+  H.helloAsync({}, function(err, result) {
+    if (err) throw err;
+    t.equal(result, '...threads are busy async bees...hello carol', 'computed result');
+    t.end();
+  });
+});